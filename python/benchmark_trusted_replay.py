@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+"""Compare checked and trusted proof replay on a fixed set of unsatisfiable formulas.
+
+The instances are generated from fixed parameters, so every run replays the same proofs.
+Solving is deterministic, so only the get_interpolant call (replay and AIG construction, which is the
+same in both modes) is timed. Run from the build directory, or with it on PYTHONPATH:
+
+    python3 benchmark_trusted_replay.py [--repetitions n]
+"""
+
+import argparse
+import itertools
+import time
+
+from interpolator_module import Interpolator, InterpolationSystem
+
+
+def pigeonhole(holes):
+    """holes + 1 pigeons in holes holes. Pigeon clauses have holes literals."""
+    def variable(pigeon, hole):
+        return pigeon * holes + hole + 1
+    clauses = [[variable(p, h) for h in range(holes)] for p in range(holes + 1)]
+    for h in range(holes):
+        for p, q in itertools.combinations(range(holes + 1), 2):
+            clauses.append([-variable(p, h), -variable(q, h)])
+    return holes * (holes + 1), clauses
+
+
+def ordering(elements):
+    """Every element of a strict total order on elements has a smaller one (GT_n). The minimum
+    clauses have elements - 1 literals, and the formula has polynomial-size refutations."""
+    def less(i, j):
+        return i * elements + j + 1
+    clauses = []
+    for i, j in itertools.permutations(range(elements), 2):
+        if i < j:
+            clauses.append([-less(i, j), -less(j, i)])
+            clauses.append([less(i, j), less(j, i)])
+        for k in range(elements):
+            if k != i and k != j:
+                clauses.append([-less(i, j), -less(j, k), less(i, k)])
+    for j in range(elements):
+        clauses.append([less(i, j) for i in range(elements) if i != j])
+    return elements * elements, clauses
+
+
+INSTANCES = [
+    ("php-7", lambda: pigeonhole(7)),
+    ("php-8", lambda: pigeonhole(8)),
+    ("gt-30", lambda: ordering(30)),
+    ("gt-40", lambda: ordering(40)),
+    ("gt-50", lambda: ordering(50)),
+]
+
+
+def time_interpolant(nr_variables, clauses, trusted):
+    interpolator = Interpolator()
+    interpolator.set_trusted_replay(trusted)
+    # The first half of the clauses is the first part, all variables are shared.
+    half = len(clauses) // 2
+    for i, clause in enumerate(clauses):
+        interpolator.add_clause(clause, i < half)
+    if interpolator.solve([]):
+        raise RuntimeError("instance is satisfiable")
+    start = time.perf_counter()
+    interpolator.get_interpolant(list(range(1, nr_variables + 1)), nr_variables + 1, False, InterpolationSystem.MCMILLAN)
+    return time.perf_counter() - start
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--repetitions", type=int, default=3, help="runs per instance and mode, the fastest is reported")
+    arguments = parser.parse_args()
+    print(f"{'instance':<10} {'clauses':>8} {'checked [s]':>12} {'trusted [s]':>12} {'speedup':>8}")
+    for name, generate in INSTANCES:
+        nr_variables, clauses = generate()
+        checked = min(time_interpolant(nr_variables, clauses, False) for _ in range(arguments.repetitions))
+        trusted = min(time_interpolant(nr_variables, clauses, True) for _ in range(arguments.repetitions))
+        print(f"{name:<10} {len(clauses):>8} {checked:>12.3f} {trusted:>12.3f} {checked / trusted:>8.2f}")
+
+
+if __name__ == "__main__":
+    main()
@@ -6,11 +6,158 @@
 namespace py = pybind11;
 
 PYBIND11_MODULE(definabilitychecker_module, m) {
+    py::enum_<DefinabilityResult>(m, "DefinabilityResult")
+        .value("DEFINED", DefinabilityResult::DEFINED)
+        .value("NOT_DEFINED", DefinabilityResult::NOT_DEFINED)
+        .value("UNKNOWN", DefinabilityResult::UNKNOWN);
+
+    // Module-local, as the interpolator module registers the same type.
+    py::class_<cadical_itp::SolveBudget>(m, "SolveBudget", py::module_local())
+        .def(py::init<>())
+        .def_readwrite("conflicts", &cadical_itp::SolveBudget::conflicts)
+        .def_readwrite("decisions", &cadical_itp::SolveBudget::decisions)
+        .def_readwrite("seconds", &cadical_itp::SolveBudget::seconds);
+
+    py::class_<cadical_itp::CancellationToken, std::shared_ptr<cadical_itp::CancellationToken>>(m, "CancellationToken", py::module_local())
+        .def(py::init<>())
+        .def("cancel", &cadical_itp::CancellationToken::cancel)
+        .def("reset", &cadical_itp::CancellationToken::reset)
+        .def("is_cancelled", &cadical_itp::CancellationToken::is_cancelled);
+
+    // Cancelled on SIGINT once InterruptHandler::interrupt is installed as signal handler.
+    m.def("global_interrupt_token", &cadical_itp::InterruptHandler::global_token);
+
+    py::class_<DefinitionCache::Statistics>(m, "DefinitionCacheStatistics")
+        .def_readonly("hits", &DefinitionCache::Statistics::hits)
+        .def_readonly("misses", &DefinitionCache::Statistics::misses)
+        .def_readonly("inserted", &DefinitionCache::Statistics::inserted)
+        .def_readonly("subsumed", &DefinitionCache::Statistics::subsumed);
+
+    py::class_<WitnessPool::Statistics>(m, "WitnessPoolStatistics")
+        .def_readonly("added", &WitnessPool::Statistics::added)
+        .def_readonly("screened", &WitnessPool::Statistics::screened)
+        .def_readonly("refuted", &WitnessPool::Statistics::refuted);
+
+    py::class_<DefinitionResult>(m, "DefinitionResult")
+        .def_readonly("variable", &DefinitionResult::variable)
+        .def_readonly("result", &DefinitionResult::result)
+        .def_readonly("definition", &DefinitionResult::definition)
+        .def_readonly("auxiliary_variable_start", &DefinitionResult::auxiliary_variable_start);
+
+    py::enum_<cadical_itp::InterpolationSystem>(m, "InterpolationSystem", py::module_local())
+        .value("MCMILLAN", cadical_itp::InterpolationSystem::MCMILLAN)
+        .value("PUDLAK", cadical_itp::InterpolationSystem::PUDLAK)
+        .value("DUAL_MCMILLAN", cadical_itp::InterpolationSystem::DUAL_MCMILLAN)
+        .value("AUTO", cadical_itp::InterpolationSystem::AUTO);
+
+    py::enum_<cadical_itp::AigOptimizationStep>(m, "AigOptimizationStep", py::module_local())
+        .value("REWRITE", cadical_itp::AigOptimizationStep::REWRITE)
+        .value("BALANCE", cadical_itp::AigOptimizationStep::BALANCE)
+        .value("REFACTOR", cadical_itp::AigOptimizationStep::REFACTOR)
+        .value("COMPRESS", cadical_itp::AigOptimizationStep::COMPRESS)
+        .value("FRAIG", cadical_itp::AigOptimizationStep::FRAIG);
+
+    py::class_<cadical_itp::AigOptimizationConfig>(m, "AigOptimizationConfig", py::module_local())
+        .def(py::init<>())
+        .def_readwrite("script", &cadical_itp::AigOptimizationConfig::script)
+        .def_readwrite("max_passes", &cadical_itp::AigOptimizationConfig::max_passes)
+        .def_readwrite("min_improvement", &cadical_itp::AigOptimizationConfig::min_improvement)
+        .def_readwrite("max_step_nodes", &cadical_itp::AigOptimizationConfig::max_step_nodes)
+        .def_readwrite("step_seconds", &cadical_itp::AigOptimizationConfig::step_seconds)
+        .def_readwrite("total_seconds", &cadical_itp::AigOptimizationConfig::total_seconds)
+        .def_readwrite("fraig_conflicts", &cadical_itp::AigOptimizationConfig::fraig_conflicts);
+
+    py::class_<cadical_itp::AigOptimizationStatistics>(m, "AigOptimizationStatistics", py::module_local())
+        .def_readonly("runs", &cadical_itp::AigOptimizationStatistics::runs)
+        .def_readonly("nodes_before", &cadical_itp::AigOptimizationStatistics::nodes_before)
+        .def_readonly("nodes_after", &cadical_itp::AigOptimizationStatistics::nodes_after)
+        .def_readonly("steps", &cadical_itp::AigOptimizationStatistics::steps)
+        .def_readonly("skipped_steps", &cadical_itp::AigOptimizationStatistics::skipped_steps)
+        .def_readonly("seconds", &cadical_itp::AigOptimizationStatistics::seconds);
+
+    m.def("parse_aig_optimization_script", &cadical_itp::parse_aig_optimization_script);
+
+    py::enum_<cadical_itp::CnfEncoding>(m, "CnfEncoding", py::module_local())
+        .value("TSEITIN", cadical_itp::CnfEncoding::TSEITIN)
+        .value("PLAISTED_GREENBAUM", cadical_itp::CnfEncoding::PLAISTED_GREENBAUM)
+        .value("LUT", cadical_itp::CnfEncoding::LUT);
+
+    py::enum_<cadical_itp::OutputPolarity>(m, "OutputPolarity", py::module_local())
+        .value("POSITIVE", cadical_itp::OutputPolarity::POSITIVE)
+        .value("NEGATIVE", cadical_itp::OutputPolarity::NEGATIVE)
+        .value("BOTH", cadical_itp::OutputPolarity::BOTH);
+
+    py::class_<cadical_itp::CnfEncodingConfig>(m, "CnfEncodingConfig", py::module_local())
+        .def(py::init<>())
+        .def_readwrite("encoding", &cadical_itp::CnfEncodingConfig::encoding)
+        .def_readwrite("polarity", &cadical_itp::CnfEncodingConfig::polarity)
+        .def_readwrite("lut_size", &cadical_itp::CnfEncodingConfig::lut_size);
+
+    py::class_<cadical_itp::CnfEncodingStatistics>(m, "CnfEncodingStatistics", py::module_local())
+        .def_readonly("encodings", &cadical_itp::CnfEncodingStatistics::encodings)
+        .def_readonly("aig_nodes", &cadical_itp::CnfEncodingStatistics::aig_nodes)
+        .def_readonly("clauses", &cadical_itp::CnfEncodingStatistics::clauses)
+        .def_readonly("literals", &cadical_itp::CnfEncodingStatistics::literals)
+        .def_readonly("auxiliary_variables", &cadical_itp::CnfEncodingStatistics::auxiliary_variables);
+
+    py::class_<cadical_itp::ProofCompressionStatistics>(m, "ProofCompressionStatistics", py::module_local())
+        .def_readonly("runs", &cadical_itp::ProofCompressionStatistics::runs)
+        .def_readonly("resolutions_before", &cadical_itp::ProofCompressionStatistics::resolutions_before)
+        .def_readonly("resolutions_after", &cadical_itp::ProofCompressionStatistics::resolutions_after)
+        .def_readonly("lowered_units", &cadical_itp::ProofCompressionStatistics::lowered_units)
+        .def_readonly("recycled_pivots", &cadical_itp::ProofCompressionStatistics::recycled_pivots)
+        .def_readonly("timeouts", &cadical_itp::ProofCompressionStatistics::timeouts)
+        .def_readonly("seconds", &cadical_itp::ProofCompressionStatistics::seconds);
+
+    py::class_<cadical_itp::ProofCacheGCStatistics>(m, "ProofCacheGCStatistics", py::module_local())
+        .def_readonly("collections", &cadical_itp::ProofCacheGCStatistics::collections)
+        .def_readonly("reclaimed_proofnodes", &cadical_itp::ProofCacheGCStatistics::reclaimed_proofnodes)
+        .def_readonly("reclaimed_aig_nodes", &cadical_itp::ProofCacheGCStatistics::reclaimed_aig_nodes)
+        .def_readonly("live_bytes", &cadical_itp::ProofCacheGCStatistics::live_bytes)
+        .def_readonly("peak_bytes", &cadical_itp::ProofCacheGCStatistics::peak_bytes)
+        .def_readonly("seconds", &cadical_itp::ProofCacheGCStatistics::seconds);
+
+    py::class_<Definabilitychecker::SliceStatistics>(m, "SliceStatistics")
+        .def_readonly("queries", &Definabilitychecker::SliceStatistics::queries)
+        .def_readonly("sliced", &Definabilitychecker::SliceStatistics::sliced)
+        .def_readonly("active_clauses", &Definabilitychecker::SliceStatistics::active_clauses);
+
     py::class_<Definabilitychecker>(m, "Definabilitychecker")
         .def(py::init<>())  // Default constructor
-        .def("add_clause", &Definabilitychecker::add_clause)
-        .def("append_formula", &Definabilitychecker::append_formula)
-        .def("has_definition", &Definabilitychecker::has_definition)
-        .def("get_definition", &Definabilitychecker::get_definition);
+        .def("add_clause", py::overload_cast<const std::vector<int>&>(&Definabilitychecker::add_clause))
+        .def("append_formula", py::overload_cast<const std::vector<std::vector<int>>&>(&Definabilitychecker::append_formula))
+        .def("has_definition", &Definabilitychecker::has_definition, py::call_guard<py::gil_scoped_release>())
+        .def("check_definition", &Definabilitychecker::check_definition, py::call_guard<py::gil_scoped_release>())
+        .def("get_definition", &Definabilitychecker::get_definition, py::arg("rewrite"), py::arg("system") = cadical_itp::InterpolationSystem::MCMILLAN,
+             py::call_guard<py::gil_scoped_release>())
+        .def("check_definitions", &Definabilitychecker::check_definitions, py::arg("variables"), py::arg("shared_variables"), py::arg("assumptions"),
+             py::arg("budget") = cadical_itp::SolveBudget{}, py::arg("with_definitions") = false, py::call_guard<py::gil_scoped_release>())
+        .def("has_definitions", &Definabilitychecker::has_definitions, py::call_guard<py::gil_scoped_release>())
+        .def("commit_shared_variables", [](Definabilitychecker& checker, const std::vector<int>& variables) {
+            checker.commit_shared_variables(variables);
+        })
+        .def("set_cancellation_token", &Definabilitychecker::set_cancellation_token)
+        .def("set_timeout", [](Definabilitychecker& checker, double seconds) {
+            checker.set_deadline(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds)));
+        })
+        .def("clear_deadline", &Definabilitychecker::clear_deadline)
+        .def("set_definition_cache", &Definabilitychecker::set_definition_cache)
+        .def("get_cache_statistics", &Definabilitychecker::get_cache_statistics, py::return_value_policy::copy)
+        .def("set_witness_pool_size", &Definabilitychecker::set_witness_pool_size)
+        .def("get_witness_statistics", &Definabilitychecker::get_witness_statistics, py::return_value_policy::copy)
+        .def("set_slicing", &Definabilitychecker::set_slicing)
+        .def("get_slice_statistics", &Definabilitychecker::get_slice_statistics, py::return_value_policy::copy)
+        .def("set_gate_detection", &Definabilitychecker::set_gate_detection)
+        .def("find_gate_definition", &Definabilitychecker::find_gate_definition)
+        .def("set_aig_optimization", &Definabilitychecker::set_aig_optimization)
+        .def("get_aig_optimization_statistics", &Definabilitychecker::get_aig_optimization_statistics, py::return_value_policy::copy)
+        .def("set_proof_compression", &Definabilitychecker::set_proof_compression)
+        .def("get_proof_compression_statistics", &Definabilitychecker::get_proof_compression_statistics, py::return_value_policy::copy)
+        .def("set_cnf_encoding", &Definabilitychecker::set_cnf_encoding)
+        .def("get_cnf_encoding_statistics", &Definabilitychecker::get_cnf_encoding_statistics, py::return_value_policy::copy)
+        .def("set_shared_aig", &Definabilitychecker::set_shared_aig)
+        .def("set_direct_aig", &Definabilitychecker::set_direct_aig)
+        .def("set_gc_watermark", &Definabilitychecker::set_gc_watermark)
+        .def("get_gc_statistics", &Definabilitychecker::get_gc_statistics, py::return_value_policy::copy);
 }
 
@@ -8,13 +8,128 @@ namespace py = pybind11;
 using namespace cadical_itp;
 
 PYBIND11_MODULE(interpolator_module, m) {
+    py::enum_<SolveResult>(m, "SolveResult")
+        .value("UNKNOWN", SolveResult::UNKNOWN)
+        .value("SAT", SolveResult::SAT)
+        .value("UNSAT", SolveResult::UNSAT);
+
+    py::class_<SolveBudget>(m, "SolveBudget")
+        .def(py::init<>())
+        .def_readwrite("conflicts", &SolveBudget::conflicts)
+        .def_readwrite("decisions", &SolveBudget::decisions)
+        .def_readwrite("seconds", &SolveBudget::seconds);
+
+    py::enum_<InterpolationSystem>(m, "InterpolationSystem")
+        .value("MCMILLAN", InterpolationSystem::MCMILLAN)
+        .value("PUDLAK", InterpolationSystem::PUDLAK)
+        .value("DUAL_MCMILLAN", InterpolationSystem::DUAL_MCMILLAN)
+        .value("AUTO", InterpolationSystem::AUTO);
+
+    py::enum_<AigOptimizationStep>(m, "AigOptimizationStep")
+        .value("REWRITE", AigOptimizationStep::REWRITE)
+        .value("BALANCE", AigOptimizationStep::BALANCE)
+        .value("REFACTOR", AigOptimizationStep::REFACTOR)
+        .value("COMPRESS", AigOptimizationStep::COMPRESS)
+        .value("FRAIG", AigOptimizationStep::FRAIG);
+
+    py::class_<AigOptimizationConfig>(m, "AigOptimizationConfig")
+        .def(py::init<>())
+        .def_readwrite("script", &AigOptimizationConfig::script)
+        .def_readwrite("max_passes", &AigOptimizationConfig::max_passes)
+        .def_readwrite("min_improvement", &AigOptimizationConfig::min_improvement)
+        .def_readwrite("max_step_nodes", &AigOptimizationConfig::max_step_nodes)
+        .def_readwrite("step_seconds", &AigOptimizationConfig::step_seconds)
+        .def_readwrite("total_seconds", &AigOptimizationConfig::total_seconds)
+        .def_readwrite("fraig_conflicts", &AigOptimizationConfig::fraig_conflicts);
+
+    py::class_<AigOptimizationStatistics>(m, "AigOptimizationStatistics")
+        .def_readonly("runs", &AigOptimizationStatistics::runs)
+        .def_readonly("nodes_before", &AigOptimizationStatistics::nodes_before)
+        .def_readonly("nodes_after", &AigOptimizationStatistics::nodes_after)
+        .def_readonly("steps", &AigOptimizationStatistics::steps)
+        .def_readonly("skipped_steps", &AigOptimizationStatistics::skipped_steps)
+        .def_readonly("seconds", &AigOptimizationStatistics::seconds);
+
+    m.def("parse_aig_optimization_script", &parse_aig_optimization_script);
+
+    py::enum_<CnfEncoding>(m, "CnfEncoding")
+        .value("TSEITIN", CnfEncoding::TSEITIN)
+        .value("PLAISTED_GREENBAUM", CnfEncoding::PLAISTED_GREENBAUM)
+        .value("LUT", CnfEncoding::LUT);
+
+    py::enum_<OutputPolarity>(m, "OutputPolarity")
+        .value("POSITIVE", OutputPolarity::POSITIVE)
+        .value("NEGATIVE", OutputPolarity::NEGATIVE)
+        .value("BOTH", OutputPolarity::BOTH);
+
+    py::class_<CnfEncodingConfig>(m, "CnfEncodingConfig")
+        .def(py::init<>())
+        .def_readwrite("encoding", &CnfEncodingConfig::encoding)
+        .def_readwrite("polarity", &CnfEncodingConfig::polarity)
+        .def_readwrite("lut_size", &CnfEncodingConfig::lut_size);
+
+    py::class_<CnfEncodingStatistics>(m, "CnfEncodingStatistics")
+        .def_readonly("encodings", &CnfEncodingStatistics::encodings)
+        .def_readonly("aig_nodes", &CnfEncodingStatistics::aig_nodes)
+        .def_readonly("clauses", &CnfEncodingStatistics::clauses)
+        .def_readonly("literals", &CnfEncodingStatistics::literals)
+        .def_readonly("auxiliary_variables", &CnfEncodingStatistics::auxiliary_variables);
+
+    py::class_<ProofCompressionStatistics>(m, "ProofCompressionStatistics")
+        .def_readonly("runs", &ProofCompressionStatistics::runs)
+        .def_readonly("resolutions_before", &ProofCompressionStatistics::resolutions_before)
+        .def_readonly("resolutions_after", &ProofCompressionStatistics::resolutions_after)
+        .def_readonly("lowered_units", &ProofCompressionStatistics::lowered_units)
+        .def_readonly("recycled_pivots", &ProofCompressionStatistics::recycled_pivots)
+        .def_readonly("timeouts", &ProofCompressionStatistics::timeouts)
+        .def_readonly("seconds", &ProofCompressionStatistics::seconds);
+
+    py::class_<ProofCacheGCStatistics>(m, "ProofCacheGCStatistics")
+        .def_readonly("collections", &ProofCacheGCStatistics::collections)
+        .def_readonly("reclaimed_proofnodes", &ProofCacheGCStatistics::reclaimed_proofnodes)
+        .def_readonly("reclaimed_aig_nodes", &ProofCacheGCStatistics::reclaimed_aig_nodes)
+        .def_readonly("live_bytes", &ProofCacheGCStatistics::live_bytes)
+        .def_readonly("peak_bytes", &ProofCacheGCStatistics::peak_bytes)
+        .def_readonly("seconds", &ProofCacheGCStatistics::seconds);
+
+    py::class_<cadical_itp::CancellationToken, std::shared_ptr<cadical_itp::CancellationToken>>(m, "CancellationToken")
+        .def(py::init<>())
+        .def("cancel", &cadical_itp::CancellationToken::cancel)
+        .def("reset", &cadical_itp::CancellationToken::reset)
+        .def("is_cancelled", &cadical_itp::CancellationToken::is_cancelled);
+
+    // Cancelled on SIGINT once InterruptHandler::interrupt is installed as signal handler.
+    m.def("global_interrupt_token", &cadical_itp::InterruptHandler::global_token);
+
     py::class_<Interpolator>(m, "Interpolator")
         .def(py::init<>())  // Default constructor
-        .def("add_clause", &Interpolator::add_clause)
-        .def("append_formula", &Interpolator::append_formula)
-        .def("solve", &Interpolator::solve)
+        .def("add_clause", py::overload_cast<const std::vector<int>&, bool>(&Interpolator::add_clause))
+        .def("append_formula", py::overload_cast<const std::vector<std::vector<int>>&, bool>(&Interpolator::append_formula))
+        .def("solve", py::overload_cast<const std::vector<int>&>(&Interpolator::solve), py::call_guard<py::gil_scoped_release>())
+        .def("solve", py::overload_cast<const std::vector<int>&, const SolveBudget&>(&Interpolator::solve), py::call_guard<py::gil_scoped_release>())
         .def("get_model", &Interpolator::get_model)
         .def("get_values", &Interpolator::get_values)
-        .def("get_interpolant", &Interpolator::get_interpolant);
+        .def("get_interpolant", &Interpolator::get_interpolant, py::arg("shared_variables"), py::arg("auxiliary_variable_start"), py::arg("rewrite_aig"),
+             py::arg("system") = InterpolationSystem::MCMILLAN, py::call_guard<py::gil_scoped_release>())
+        .def("set_cancellation_token", &Interpolator::set_cancellation_token)
+        .def("set_timeout", [](Interpolator& interpolator, double seconds) {
+            interpolator.set_deadline(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds)));
+        })
+        .def("clear_deadline", &Interpolator::clear_deadline)
+        .def("set_direct_aig", &Interpolator::set_direct_aig)
+        .def("set_replay_threads", &Interpolator::set_replay_threads)
+        .def("set_trusted_replay", &Interpolator::set_trusted_replay)
+        .def("set_gc_watermark", &Interpolator::set_gc_watermark)
+        .def("collect_garbage", &Interpolator::collect_garbage)
+        .def("get_proof_cache_memory_usage", &Interpolator::get_proof_cache_memory_usage)
+        .def("get_gc_statistics", &Interpolator::get_gc_statistics, py::return_value_policy::copy)
+        .def("set_aig_optimization", &Interpolator::set_aig_optimization)
+        .def("get_aig_optimization_statistics", &Interpolator::get_aig_optimization_statistics, py::return_value_policy::copy)
+        .def("set_proof_compression", &Interpolator::set_proof_compression)
+        .def("get_proof_compression_statistics", &Interpolator::get_proof_compression_statistics, py::return_value_policy::copy)
+        .def("set_cnf_encoding", &Interpolator::set_cnf_encoding)
+        .def("get_cnf_encoding_statistics", &Interpolator::get_cnf_encoding_statistics, py::return_value_policy::copy)
+        .def("set_shared_aig", &Interpolator::set_shared_aig)
+        .def("get_shared_aig_size", &Interpolator::get_shared_aig_size);
 }
 
@@ -0,0 +1,143 @@
+#include "aig_optimizer.hpp"
+
+#include <chrono>
+#include <mutex>
+
+#include "opt/dar/dar.h"
+#include "proof/fra/fra.h"
+
+namespace cadical_itp {
+
+namespace {
+
+std::mutex dar_library_mutex;
+unsigned nr_dar_library_users = 0;
+
+// Run an in-place ABC pass on a DFS-ordered copy and return the cleaned up result.
+template <typename Pass>
+abc::Aig_Man_t* run_in_place(abc::Aig_Man_t* man, Pass pass) {
+  auto copy = abc::Aig_ManDupDfs(man);
+  pass(copy);
+  auto result = abc::Aig_ManDupDfs(copy);
+  abc::Aig_ManStop(copy);
+  return result;
+}
+
+abc::Aig_Man_t* run_step(abc::Aig_Man_t* man, AigOptimizationStep step, const AigOptimizationConfig& config) {
+  abc::Aig_Man_t* result = nullptr;
+  switch (step) {
+    case AigOptimizationStep::REWRITE: {
+      std::lock_guard<std::mutex> lock(dar_library_mutex);
+      result = run_in_place(man, [](abc::Aig_Man_t* copy) {
+        abc::Dar_RwrPar_t parameters;
+        abc::Dar_ManDefaultRwrParams(&parameters);
+        abc::Dar_ManRewrite(copy, &parameters);
+      });
+      break;
+    }
+    case AigOptimizationStep::BALANCE:
+      result = abc::Dar_ManBalance(man, 0);
+      break;
+    case AigOptimizationStep::REFACTOR:
+      result = run_in_place(man, [](abc::Aig_Man_t* copy) {
+        abc::Dar_RefPar_t parameters;
+        abc::Dar_ManDefaultRefParams(&parameters);
+        abc::Dar_ManRefactor(copy, &parameters);
+      });
+      break;
+    case AigOptimizationStep::COMPRESS: {
+      std::lock_guard<std::mutex> lock(dar_library_mutex);
+      result = abc::Dar_ManCompress2(man, 1, 0, 1, 0, 0);
+      break;
+    }
+    case AigOptimizationStep::FRAIG:
+      result = abc::Fra_FraigEquivence(man, config.fraig_conflicts, 0);
+      break;
+  }
+  // None of the passes frees its input.
+  abc::Aig_ManStop(man);
+  return result;
+}
+
+}
+
+std::vector<AigOptimizationStep> parse_aig_optimization_script(const std::string& script) {
+  std::vector<AigOptimizationStep> steps;
+  std::size_t begin = 0;
+  while (begin <= script.size()) {
+    auto end = script.find(';', begin);
+    if (end == std::string::npos) {
+      end = script.size();
+    }
+    auto name = script.substr(begin, end - begin);
+    begin = end + 1;
+    if (name.empty()) {
+      continue;
+    } else if (name == "rw" || name == "rewrite") {
+      steps.push_back(AigOptimizationStep::REWRITE);
+    } else if (name == "b" || name == "balance") {
+      steps.push_back(AigOptimizationStep::BALANCE);
+    } else if (name == "rf" || name == "refactor") {
+      steps.push_back(AigOptimizationStep::REFACTOR);
+    } else if (name == "dc2" || name == "compress") {
+      steps.push_back(AigOptimizationStep::COMPRESS);
+    } else if (name == "fraig") {
+      steps.push_back(AigOptimizationStep::FRAIG);
+    } else {
+      throw AigOptimizerException("unknown AIG optimization step " + name);
+    }
+  }
+  return steps;
+}
+
+abc::Aig_Man_t* optimize_aig(abc::Aig_Man_t* man, const AigOptimizationConfig& config, AigOptimizationStatistics& statistics) {
+  auto start = std::chrono::steady_clock::now();
+  auto elapsed = [](std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+  };
+  statistics.runs++;
+  statistics.nodes_before += abc::Aig_ManNodeNum(man);
+  std::vector<bool> too_slow(config.script.size(), false);
+  bool out_of_time = false;
+  for (unsigned pass = 0; pass < config.max_passes && !out_of_time && abc::Aig_ManNodeNum(man) > 0; pass++) {
+    auto nodes_before_pass = abc::Aig_ManNodeNum(man);
+    for (std::size_t i = 0; i < config.script.size(); i++) {
+      if (config.total_seconds > 0 && elapsed(start) >= config.total_seconds) {
+        statistics.skipped_steps += config.script.size() - i;
+        out_of_time = true;
+        break;
+      }
+      if (too_slow[i] || (config.max_step_nodes > 0 && abc::Aig_ManNodeNum(man) > config.max_step_nodes)) {
+        statistics.skipped_steps++;
+        continue;
+      }
+      auto step_start = std::chrono::steady_clock::now();
+      man = run_step(man, config.script[i], config);
+      statistics.steps++;
+      too_slow[i] = config.step_seconds > 0 && elapsed(step_start) > config.step_seconds;
+    }
+    // Stop once another pass is not worth it.
+    if (nodes_before_pass - abc::Aig_ManNodeNum(man) < config.min_improvement * nodes_before_pass) {
+      break;
+    }
+  }
+  statistics.nodes_after += abc::Aig_ManNodeNum(man);
+  statistics.seconds += elapsed(start);
+  return man;
+}
+
+void acquire_dar_library() {
+  std::lock_guard<std::mutex> lock(dar_library_mutex);
+  if (nr_dar_library_users++ == 0) {
+    abc::Dar_LibStart();
+  }
+}
+
+void release_dar_library() {
+  std::lock_guard<std::mutex> lock(dar_library_mutex);
+  if (--nr_dar_library_users == 0) {
+    abc::Dar_LibStop();
+  }
+}
+
+}
@@ -0,0 +1,72 @@
+#ifndef ITP_AIG_OPTIMIZER_H_
+#define ITP_AIG_OPTIMIZER_H_
+
+#include <vector>
+#include <string>
+#include <exception>
+#include <cstdint>
+
+#include "aig/aig/aig.h"
+
+namespace cadical_itp {
+
+class AigOptimizerException: public std::exception {
+ public:
+  explicit AigOptimizerException(const std::string& message): message(message) {}
+
+  const char* what() const noexcept override {
+    return message.c_str();
+  }
+
+ private:
+  std::string message;
+};
+
+enum class AigOptimizationStep {
+  REWRITE,  // DAG-aware rewriting (ABC: rw)
+  BALANCE,  // Balancing of AND trees (ABC: b)
+  REFACTOR, // Collapsing and refactoring of cones (ABC: rf)
+  COMPRESS, // Balance, rewrite and refactor with choices (ABC: dc2)
+  FRAIG     // Merging of functionally equivalent nodes with SAT (ABC: fraig)
+};
+
+struct AigOptimizationConfig {
+  std::vector<AigOptimizationStep> script{AigOptimizationStep::REWRITE};
+  // The script is repeated until a pass removes less than min_improvement of the nodes.
+  unsigned max_passes = 1;
+  double min_improvement = 0.02;
+  // Steps are skipped on AIGs with more nodes than this (0: no limit).
+  int max_step_nodes = 0;
+  // A step that takes longer than step_seconds is not run again in later passes, and no step
+  // is started once the optimization took total_seconds (0: no limit).
+  double step_seconds = 0;
+  double total_seconds = 0;
+  // Conflict limit of the SAT calls of FRAIG.
+  int fraig_conflicts = 100;
+};
+
+// Parse a script of semicolon-separated steps, named as in ABC (e.g. "b;rw;rf;b;rw").
+// Throws AigOptimizerException for unknown steps.
+std::vector<AigOptimizationStep> parse_aig_optimization_script(const std::string& script);
+
+struct AigOptimizationStatistics {
+  uint64_t runs = 0;
+  uint64_t nodes_before = 0;
+  uint64_t nodes_after = 0;
+  uint64_t steps = 0;
+  uint64_t skipped_steps = 0;
+  double seconds = 0;
+};
+
+// Optimize an AIG with a single output. Takes ownership of the AIG and returns the optimized one.
+// Combinational inputs keep their order.
+abc::Aig_Man_t* optimize_aig(abc::Aig_Man_t* man, const AigOptimizationConfig& config, AigOptimizationStatistics& statistics);
+
+// The rewriting library of ABC is global state: it is started once for all its users
+// and steps that update it are serialized.
+void acquire_dar_library();
+void release_dar_library();
+
+}
+
+#endif // ITP_AIG_OPTIMIZER_H_
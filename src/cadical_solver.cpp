@@ -3,12 +3,12 @@
 
 #include <unistd.h>
 
+#include <algorithm>
+#include <climits>
 #include <iostream>
 
 namespace cadical_itp {
 
-Cadical::CadicalTerminator Cadical::terminator;
-
 Cadical::Cadical() {
   solver.connect_terminator(&terminator);
   solver.set("lrat", true);
@@ -22,7 +22,19 @@ Cadical::~Cadical() {
 }
 
 bool Cadical::CadicalTerminator::terminate() {
-  return InterruptHandler::interrupted(nullptr);
+  return is_cancelled() || (has_deadline && std::chrono::steady_clock::now() >= deadline);
+}
+
+void Cadical::set_cancellation_token(std::shared_ptr<CancellationToken> token) {
+  terminator.token = std::move(token);
+}
+
+void Cadical::set_deadline(std::chrono::steady_clock::time_point deadline) {
+  this->deadline = deadline;
+}
+
+void Cadical::clear_deadline() {
+  deadline.reset();
 }
 
 void Cadical::append_formula(const std::vector<std::vector<int>>& formula) {
@@ -31,7 +43,13 @@ void Cadical::append_formula(const std::vector<std::vector<int>>& formula) {
   }
 }
 
-void Cadical::add_clause(const std::vector<int>& clause) {
+void Cadical::append_formula(std::span<const int> literals, std::span<const std::size_t> offsets) {
+  for (std::size_t i = 0; i + 1 < offsets.size(); i++) {
+    add_clause(literals.subspan(offsets[i], offsets[i + 1] - offsets[i]));
+  }
+}
+
+void Cadical::add_clause(std::span<const int> clause) {
   for (auto l: clause) {
     solver.add(l);
   }
@@ -55,16 +73,45 @@ int Cadical::solve(const std::vector<int>& assumptions) {
 }
 
 int Cadical::solve() {
+  return run_solver(0);
+}
+
+int Cadical::solve(int conflict_limit) {
+  solver.limit("conflicts", conflict_limit);
+  return solve();
+}
+
+// Solve with the absolute deadline, tightened by a time budget for this call (if positive).
+int Cadical::run_solver(double seconds) {
+  terminator.has_deadline = deadline.has_value();
+  if (terminator.has_deadline) {
+    terminator.deadline = *deadline;
+  }
+  if (seconds > 0) {
+    auto call_deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+    if (!terminator.has_deadline || call_deadline < terminator.deadline) {
+      terminator.deadline = call_deadline;
+      terminator.has_deadline = true;
+    }
+  }
   int result = solver.solve();
-  if (InterruptHandler::interrupted(nullptr)) {
+  terminator.has_deadline = false;
+  if (terminator.is_cancelled()) {
     throw InterruptedException();
   }
   return result;
 }
 
-int Cadical::solve(int conflict_limit) {
-  solver.limit("conflicts", conflict_limit);
-  return solve();
+int Cadical::solve(const std::vector<int>& assumptions, const SolveBudget& budget) {
+  set_assumptions(assumptions);
+  // Limits only apply to the next call.
+  if (budget.conflicts > 0) {
+    solver.limit("conflicts", static_cast<int>(std::min<int64_t>(budget.conflicts, INT_MAX)));
+  }
+  if (budget.decisions > 0) {
+    solver.limit("decisions", static_cast<int>(std::min<int64_t>(budget.decisions, INT_MAX)));
+  }
+  return run_solver(budget.seconds);
 }
 
 std::vector<int> Cadical::get_failed(const std::vector<int>& assumptions) {
@@ -2,22 +2,62 @@
 #define ITP_CADICAL_H_
 
 #include <vector>
+#include <span>
+#include <memory>
 #include <cstdio>
+#include <cstdint>
+#include <chrono>
+#include <optional>
 
 #include "cadical.hpp"
 
+#include "clause_arena.hpp"
+#include "interrupt.hpp"
+
 namespace cadical_itp {
 
+enum class SolveResult {
+  UNKNOWN,
+  SAT,
+  UNSAT
+};
+
+// Limits for a single solve call, 0 meaning unlimited.
+// CaDiCaL can only limit conflicts and decisions, not propagations.
+struct SolveBudget {
+  int64_t conflicts = 0;
+  int64_t decisions = 0;
+  double seconds = 0;
+
+  bool is_limited() const { return conflicts > 0 || decisions > 0 || seconds > 0; }
+  SolveBudget scaled(double factor) const;
+};
+
+inline SolveBudget SolveBudget::scaled(double factor) const {
+  return SolveBudget{static_cast<int64_t>(conflicts * factor), static_cast<int64_t>(decisions * factor), seconds * factor};
+}
+
 class Cadical {
  public:
   Cadical();
   ~Cadical();
   void append_formula(const std::vector<std::vector<int>>& formula);
+  void append_formula(const ClauseArena& formula);
+  void append_formula(std::span<const int> literals, std::span<const std::size_t> offsets);
   void add_clause(const std::vector<int>& clause);
+  void add_clause(std::span<const int> clause);
   void assume(const std::vector<int>& assumptions);
   int solve(const std::vector<int>& assumptions);
   int solve();
   int solve(int conflict_limit);
+  // Returns 10 (SAT), 20 (UNSAT) or 0 if the budget was exhausted or the deadline passed.
+  // Throws InterruptedException if the cancellation token was cancelled. The solver stays usable in all cases.
+  int solve(const std::vector<int>& assumptions, const SolveBudget& budget);
+  // Token checked during search (none by default). Use InterruptHandler::global_token() to react to SIGINT.
+  void set_cancellation_token(std::shared_ptr<CancellationToken> token);
+  // Absolute deadline for all following solve calls.
+  void set_deadline(std::chrono::steady_clock::time_point deadline);
+  void clear_deadline();
   std::vector<int> get_failed(const std::vector<int>& assumptions);
   std::vector<int> get_values(const std::vector<int>& variables);
   std::vector<int> get_model();
@@ -25,24 +65,41 @@ class Cadical {
   uint64_t get_current_clause_id() const;
   uint64_t get_latest_id() const;
   bool is_initial_clause(uint64_t id) const;
-  const std::vector<uint64_t>& get_premises(uint64_t id) const;
-  const std::vector<int>& get_clause(uint64_t id) const;
+  std::span<const uint64_t> get_premises(uint64_t id) const;
+  std::span<const int> get_clause(uint64_t id) const;
   const std::vector<uint64_t>& get_delete_ids() const;
   void clear_delete_ids();
 
  private:
   void set_assumptions(const std::vector<int>& assumptions);
+  int run_solver(double seconds);
 
   CaDiCaL::Solver solver;
 
+  // Stops the search when the token is cancelled or the deadline of the current call has passed.
   class CadicalTerminator: public CaDiCaL::Terminator {
    public:
     virtual bool terminate();
+    bool is_cancelled() const { return token && token->is_cancelled(); }
+
+    std::shared_ptr<CancellationToken> token;
+    bool has_deadline = false;
+    std::chrono::steady_clock::time_point deadline;
   };
 
-  static CadicalTerminator terminator;
+  std::optional<std::chrono::steady_clock::time_point> deadline;
+
+  CadicalTerminator terminator;
 };
 
+inline void Cadical::append_formula(const ClauseArena& formula) {
+  append_formula(formula.get_literals(), formula.get_offsets());
+}
+
+inline void Cadical::add_clause(const std::vector<int>& clause) {
+  add_clause(std::span<const int>(clause));
+}
+
 inline uint64_t Cadical::get_current_clause_id() const {
   return solver.get_current_clause_id();
 }
@@ -55,11 +112,11 @@ inline bool Cadical::is_initial_clause(uint64_t id) const {
   return solver.is_initial_clause(id);
 }
 
-inline const std::vector<uint64_t>& Cadical::get_premises(uint64_t id) const {
+inline std::span<const uint64_t> Cadical::get_premises(uint64_t id) const {
   return solver.get_premises(id);
 }
 
-inline const std::vector<int>& Cadical::get_clause(uint64_t id) const {
+inline std::span<const int> Cadical::get_clause(uint64_t id) const {
   return solver.get_clause(id);
 }
 
@@ -0,0 +1,76 @@
+#ifndef ITP_CLAUSE_ARENA_H_
+#define ITP_CLAUSE_ARENA_H_
+
+#include <vector>
+#include <span>
+#include <cstddef>
+
+namespace cadical_itp {
+
+// Flat (CSR) clause storage: the literals of all clauses in one contiguous
+// buffer, clause i occupying literals[offsets[i]..offsets[i+1]).
+class ClauseArena {
+ public:
+  ClauseArena(): offsets{0} {}
+
+  class const_iterator {
+   public:
+    const_iterator(const ClauseArena& arena, std::size_t index): arena(&arena), index(index) {}
+    std::span<const int> operator*() const { return (*arena)[index]; }
+    const_iterator& operator++() { index++; return *this; }
+    bool operator==(const const_iterator& other) const { return index == other.index; }
+   private:
+    const ClauseArena* arena;
+    std::size_t index;
+  };
+
+  void reserve(std::size_t nr_clauses, std::size_t nr_literals);
+  void add_literal(int literal);
+  void finish_clause();
+  void add_clause(std::span<const int> clause);
+  void clear();
+
+  std::size_t size() const { return offsets.size() - 1; }
+  bool empty() const { return size() == 0; }
+  std::size_t nr_literals() const { return literals.size(); }
+  std::span<const int> operator[](std::size_t i) const;
+  const_iterator begin() const { return const_iterator(*this, 0); }
+  const_iterator end() const { return const_iterator(*this, size()); }
+  const std::vector<int>& get_literals() const { return literals; }
+  const std::vector<std::size_t>& get_offsets() const { return offsets; }
+
+ private:
+  std::vector<int> literals;
+  std::vector<std::size_t> offsets;
+};
+
+inline void ClauseArena::reserve(std::size_t nr_clauses, std::size_t nr_literals) {
+  offsets.reserve(nr_clauses + 1);
+  literals.reserve(nr_literals);
+}
+
+inline void ClauseArena::add_literal(int literal) {
+  literals.push_back(literal);
+}
+
+inline void ClauseArena::finish_clause() {
+  offsets.push_back(literals.size());
+}
+
+inline void ClauseArena::add_clause(std::span<const int> clause) {
+  literals.insert(literals.end(), clause.begin(), clause.end());
+  finish_clause();
+}
+
+inline void ClauseArena::clear() {
+  literals.clear();
+  offsets.assign(1, 0);
+}
+
+inline std::span<const int> ClauseArena::operator[](std::size_t i) const {
+  return std::span<const int>(literals.data() + offsets[i], offsets[i + 1] - offsets[i]);
+}
+
+}
+
+#endif // ITP_CLAUSE_ARENA_H_
@@ -0,0 +1,478 @@
+#include "cnf_encoder.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <cassert>
+#include <cstdlib>
+#include <iterator>
+
+using namespace abc; // Needed for macro expansion.
+
+namespace cadical_itp {
+
+namespace {
+
+// Truth tables of functions over up to six cut leaves.
+using TruthTable = uint64_t;
+
+constexpr unsigned MAX_LUT_SIZE = 6;
+constexpr TruthTable VARIABLE_TRUTH_TABLES[MAX_LUT_SIZE] = {
+  0xAAAAAAAAAAAAAAAAull, 0xCCCCCCCCCCCCCCCCull, 0xF0F0F0F0F0F0F0F0ull,
+  0xFF00FF00FF00FF00ull, 0xFFFF0000FFFF0000ull, 0xFFFFFFFF00000000ull
+};
+
+// Polarities in which a node is used, as a bit set.
+constexpr uint8_t POSITIVE_POLARITY = 1;
+constexpr uint8_t NEGATIVE_POLARITY = 2;
+
+// Product term over the cut leaves, as bit sets of the leaves occurring positively and negatively.
+struct Cube {
+  uint8_t positive;
+  uint8_t negative;
+};
+
+TruthTable negative_cofactor(TruthTable table, unsigned variable) {
+  auto low = table & ~VARIABLE_TRUTH_TABLES[variable];
+  return low | (low << (1u << variable));
+}
+
+TruthTable positive_cofactor(TruthTable table, unsigned variable) {
+  auto high = table & VARIABLE_TRUTH_TABLES[variable];
+  return high | (high >> (1u << variable));
+}
+
+// Minato-Morreale: add an irredundant cover of a function between on_set and upper_bound, depending
+// only on the first nr_variables variables, to cubes (extending cube). Returns the function of the cover.
+TruthTable compute_isop(TruthTable on_set, TruthTable upper_bound, unsigned nr_variables, Cube cube, std::vector<Cube>& cubes) {
+  if (on_set == 0) {
+    return 0;
+  }
+  if (upper_bound == ~TruthTable(0)) {
+    cubes.push_back(cube);
+    return ~TruthTable(0);
+  }
+  auto variable = nr_variables;
+  do {
+    assert(variable > 0);
+    variable--;
+  } while (negative_cofactor(on_set, variable) == positive_cofactor(on_set, variable) &&
+           negative_cofactor(upper_bound, variable) == positive_cofactor(upper_bound, variable));
+  auto on_set0 = negative_cofactor(on_set, variable);
+  auto on_set1 = positive_cofactor(on_set, variable);
+  auto upper_bound0 = negative_cofactor(upper_bound, variable);
+  auto upper_bound1 = positive_cofactor(upper_bound, variable);
+  uint8_t bit = 1u << variable;
+  auto cover0 = compute_isop(on_set0 & ~upper_bound1, upper_bound0, variable, Cube{cube.positive, static_cast<uint8_t>(cube.negative | bit)}, cubes);
+  auto cover1 = compute_isop(on_set1 & ~upper_bound0, upper_bound1, variable, Cube{static_cast<uint8_t>(cube.positive | bit), cube.negative}, cubes);
+  auto cover2 = compute_isop((on_set0 & ~cover0) | (on_set1 & ~cover1), upper_bound0 & upper_bound1, variable, cube, cubes);
+  return (cover0 & ~VARIABLE_TRUTH_TABLES[variable]) | (cover1 & VARIABLE_TRUTH_TABLES[variable]) | cover2;
+}
+
+std::vector<std::vector<int>> encode_tseitin(abc::Aig_Man_t* man, std::span<const int> input_variables, int auxiliary_variable_start) {
+  std::vector<std::vector<int>> clauses;
+  clauses.reserve(3 * abc::Aig_ManNodeNum(man) + 3);
+  abc::Vec_Ptr_t * vNodes;
+  abc::Aig_Obj_t * pObj, * pConst1 = NULL;
+  int i;
+  // check if constant is used
+  Aig_ManForEachCo( man, pObj, i) {
+    if (abc::Aig_ObjIsConst1(abc::Aig_ObjFanin0(pObj)))
+      pConst1 = abc::Aig_ManConst1(man);
+  }
+  // Assign shared variables to CIs.
+  Aig_ManForEachCi( man, pObj, i) {
+    pObj->iData = input_variables[i];
+  }
+  // collect nodes in the DFS order
+  vNodes = abc::Aig_ManDfs(man, 1);
+  // assign IDs to objects
+  Aig_ManForEachCo( man, pObj, i ) {
+    pObj->iData = auxiliary_variable_start++;
+  }
+  abc::Aig_ManConst1(man)->iData = auxiliary_variable_start++;
+  Vec_PtrForEachEntry( abc::Aig_Obj_t *, vNodes, pObj, i ) {
+    pObj->iData = auxiliary_variable_start++;
+  }
+  // Add clauses from Tseitin conversion.
+  if (pConst1) { // Constant 1 if necessary.
+    clauses.push_back( { pConst1->iData } );
+  }
+  Vec_PtrForEachEntry( abc::Aig_Obj_t *, vNodes, pObj, i ) {
+    auto variable_output = pObj->iData;
+    auto variable_input0 = abc::Aig_ObjFanin0(pObj)->iData;
+    auto variable_input1 = abc::Aig_ObjFanin1(pObj)->iData;
+    auto literal_input0 = Aig_ObjFaninC0(pObj) ? -variable_input0 : variable_input0;
+    auto literal_input1 = Aig_ObjFaninC1(pObj) ? -variable_input1 : variable_input1;
+    clauses.push_back( { literal_input0, -variable_output } );
+    clauses.push_back( { literal_input1, -variable_output } );
+    clauses.push_back( { -literal_input0, -literal_input1, variable_output } );
+  }
+  // Write clauses for PO.
+  Aig_ManForEachCo( man, pObj, i ) {
+    auto variable_output = pObj->iData;
+    auto variable_input0 = abc::Aig_ObjFanin0(pObj)->iData;
+    auto literal_input0 = Aig_ObjFaninC0(pObj) ? -variable_input0 : variable_input0;
+    clauses.push_back( { literal_input0, -variable_output } );
+    clauses.push_back( { -literal_input0, variable_output } );
+  }
+  abc::Vec_PtrFree( vNodes );
+  return clauses;
+}
+
+// Plaisted-Greenbaum encoding, generalized to cuts: every used node gets clauses for the implications
+// between its variable and the function of its cut leaves, in the directions it is used in.
+// With lut_size 0, the cut of each node consists of its fanins.
+class PolarityEncoder {
+ public:
+  PolarityEncoder(abc::Aig_Man_t* man, std::span<const int> input_variables, int auxiliary_variable_start, unsigned lut_size);
+  ~PolarityEncoder() { abc::Vec_PtrFree(nodes); }
+  std::vector<std::vector<int>> encode(OutputPolarity polarity);
+
+ private:
+  void compute_cuts();
+  int get_literal(abc::Aig_Obj_t* node, bool complemented);
+  void add_clause(std::vector<int> clause);
+  unsigned compute_cost(TruthTable table, std::size_t nr_leaves);
+  TruthTable compute_truth_table(abc::Aig_Obj_t* root, std::span<abc::Aig_Obj_t* const> cut);
+  void encode_node(abc::Aig_Obj_t* node);
+
+  abc::Aig_Man_t* man;
+  unsigned lut_size;
+  abc::Vec_Ptr_t* nodes;
+  int next_variable;
+  // Indexed by object ids.
+  std::vector<int> variables;
+  std::vector<uint8_t> polarities;
+  std::vector<std::vector<abc::Aig_Obj_t*>> cuts;
+  std::vector<TruthTable> truth_tables;
+  std::vector<unsigned> truth_table_stamps;
+  unsigned truth_table_stamp;
+  std::vector<abc::Aig_Obj_t*> stack;
+  std::vector<Cube> cubes;
+  std::vector<std::vector<int>> clauses;
+};
+
+PolarityEncoder::PolarityEncoder(abc::Aig_Man_t* man, std::span<const int> input_variables, int auxiliary_variable_start, unsigned lut_size):
+  man(man), lut_size(lut_size), nodes(abc::Aig_ManDfs(man, 1)), next_variable(auxiliary_variable_start),
+  variables(abc::Aig_ManObjNumMax(man), 0), polarities(abc::Aig_ManObjNumMax(man), 0), cuts(abc::Aig_ManObjNumMax(man)),
+  truth_tables(abc::Aig_ManObjNumMax(man), 0), truth_table_stamps(abc::Aig_ManObjNumMax(man), 0), truth_table_stamp(0) {
+  abc::Aig_Obj_t* pObj;
+  int i;
+  Aig_ManForEachCi( man, pObj, i ) {
+    variables[abc::Aig_ObjId(pObj)] = input_variables[i];
+  }
+  compute_cuts();
+}
+
+// Greedy cone collapsing: a node with a single fanout is merged into the cut of its fanout if that
+// cut keeps at most lut_size leaves and the clauses of the merged cone are not larger than separate ones.
+void PolarityEncoder::compute_cuts() {
+  std::vector<unsigned> nr_fanouts(variables.size(), 0);
+  abc::Aig_Obj_t* pObj;
+  int i;
+  Vec_PtrForEachEntry( abc::Aig_Obj_t *, nodes, pObj, i ) {
+    nr_fanouts[abc::Aig_ObjId(abc::Aig_ObjFanin0(pObj))]++;
+    nr_fanouts[abc::Aig_ObjId(abc::Aig_ObjFanin1(pObj))]++;
+  }
+  Aig_ManForEachCo( man, pObj, i ) {
+    nr_fanouts[abc::Aig_ObjId(abc::Aig_ObjFanin0(pObj))]++;
+  }
+  auto by_id = [](abc::Aig_Obj_t* a, abc::Aig_Obj_t* b) { return abc::Aig_ObjId(a) < abc::Aig_ObjId(b); };
+  std::vector<unsigned> costs(variables.size(), 0);
+  std::vector<abc::Aig_Obj_t*> fanin_leaves[2];
+  std::vector<abc::Aig_Obj_t*> cut;
+  std::vector<abc::Aig_Obj_t*> merged_nodes;
+  Vec_PtrForEachEntry( abc::Aig_Obj_t *, nodes, pObj, i ) {
+    auto id = abc::Aig_ObjId(pObj);
+    abc::Aig_Obj_t* fanins[2] = {abc::Aig_ObjFanin0(pObj), abc::Aig_ObjFanin1(pObj)};
+    bool mergeable[2];
+    for (int j = 0; j < 2; j++) {
+      mergeable[j] = lut_size > 0 && abc::Aig_ObjIsNode(fanins[j]) && nr_fanouts[abc::Aig_ObjId(fanins[j])] == 1;
+    }
+    // Among merging both, either or none of the fanins, take the cheapest, preferring fewer variables.
+    bool best_merged[2] = {false, false};
+    unsigned best_cost = std::numeric_limits<unsigned>::max();
+    for (auto merged: {std::pair{true, true}, std::pair{true, false}, std::pair{false, true}, std::pair{false, false}}) {
+      bool merged_fanins[2] = {merged.first, merged.second};
+      if ((merged_fanins[0] && !mergeable[0]) || (merged_fanins[1] && !mergeable[1])) {
+        continue;
+      }
+      unsigned cost = 0;
+      for (int j = 0; j < 2; j++) {
+        if (merged_fanins[j]) {
+          fanin_leaves[j] = cuts[abc::Aig_ObjId(fanins[j])];
+        } else {
+          fanin_leaves[j].assign(1, fanins[j]);
+          cost += costs[abc::Aig_ObjId(fanins[j])];
+        }
+      }
+      cut.clear();
+      std::ranges::set_union(fanin_leaves[0], fanin_leaves[1], std::back_inserter(cut), by_id);
+      if (cut.size() > std::max(lut_size, 2u)) {
+        continue;
+      }
+      cost += compute_cost(compute_truth_table(pObj, cut), cut.size());
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_merged[0] = merged_fanins[0];
+        best_merged[1] = merged_fanins[1];
+        cuts[id] = cut;
+      }
+    }
+    // The cost of a node includes the nodes merged into it; fanins encoded on their own are paid for separately.
+    costs[id] = best_cost;
+    for (int j = 0; j < 2; j++) {
+      if (best_merged[j]) {
+        merged_nodes.push_back(fanins[j]);
+      } else {
+        costs[id] -= costs[abc::Aig_ObjId(fanins[j])];
+      }
+    }
+  }
+  // Merged nodes are never encoded on their own.
+  for (auto node: merged_nodes) {
+    std::vector<abc::Aig_Obj_t*>().swap(cuts[abc::Aig_ObjId(node)]);
+  }
+}
+
+// The literal of a used node. Records the polarity of the use, as a positive occurrence of the
+// variable needs the implication from the variable to the function and a negative one the converse.
+int PolarityEncoder::get_literal(abc::Aig_Obj_t* node, bool complemented) {
+  auto id = abc::Aig_ObjId(node);
+  if (variables[id] == 0) {
+    variables[id] = next_variable++;
+  }
+  polarities[id] |= complemented ? NEGATIVE_POLARITY : POSITIVE_POLARITY;
+  return complemented ? -variables[id] : variables[id];
+}
+
+void PolarityEncoder::add_clause(std::vector<int> clause) {
+  clauses.push_back(std::move(clause));
+}
+
+// Number of literals of the clauses for both implications between a node and its function.
+unsigned PolarityEncoder::compute_cost(TruthTable table, std::size_t nr_leaves) {
+  unsigned cost = 0;
+  for (auto function: {table, ~table}) {
+    cubes.clear();
+    compute_isop(function, function, nr_leaves, Cube{0, 0}, cubes);
+    for (auto cube: cubes) {
+      cost += std::popcount(static_cast<unsigned>(cube.positive | cube.negative)) + 1;
+    }
+  }
+  return cost;
+}
+
+// Function of root over the given cut leaves, evaluated bottom-up through the nodes in between.
+TruthTable PolarityEncoder::compute_truth_table(abc::Aig_Obj_t* root, std::span<abc::Aig_Obj_t* const> cut) {
+  truth_table_stamp++;
+  for (std::size_t j = 0; j < cut.size(); j++) {
+    auto id = abc::Aig_ObjId(cut[j]);
+    truth_tables[id] = VARIABLE_TRUTH_TABLES[j];
+    truth_table_stamps[id] = truth_table_stamp;
+  }
+  stack.push_back(root);
+  while (!stack.empty()) {
+    auto node = stack.back();
+    if (truth_table_stamps[abc::Aig_ObjId(node)] == truth_table_stamp) {
+      stack.pop_back();
+      continue;
+    }
+    auto fanin0 = abc::Aig_ObjFanin0(node);
+    auto fanin1 = abc::Aig_ObjFanin1(node);
+    bool children_pending = false;
+    for (auto fanin: {fanin1, fanin0}) {
+      if (truth_table_stamps[abc::Aig_ObjId(fanin)] != truth_table_stamp) {
+        stack.push_back(fanin);
+        children_pending = true;
+      }
+    }
+    if (children_pending) {
+      continue;
+    }
+    stack.pop_back();
+    auto table0 = truth_tables[abc::Aig_ObjId(fanin0)];
+    auto table1 = truth_tables[abc::Aig_ObjId(fanin1)];
+    truth_tables[abc::Aig_ObjId(node)] = (abc::Aig_ObjFaninC0(node) ? ~table0 : table0) & (abc::Aig_ObjFaninC1(node) ? ~table1 : table1);
+    truth_table_stamps[abc::Aig_ObjId(node)] = truth_table_stamp;
+  }
+  return truth_tables[abc::Aig_ObjId(root)];
+}
+
+void PolarityEncoder::encode_node(abc::Aig_Obj_t* node) {
+  auto id = abc::Aig_ObjId(node);
+  auto polarity = polarities[id];
+  const auto& cut = cuts[id];
+  auto table = compute_truth_table(node, cut);
+  // The node implies its function if the off-set cubes imply its negation, and the function implies the
+  // node if the on-set cubes imply it.
+  for (auto direction: {POSITIVE_POLARITY, NEGATIVE_POLARITY}) {
+    if (!(polarity & direction)) {
+      continue;
+    }
+    cubes.clear();
+    auto function = direction == POSITIVE_POLARITY ? ~table : table;
+    compute_isop(function, function, cut.size(), Cube{0, 0}, cubes);
+    for (auto cube: cubes) {
+      std::vector<int> clause;
+      clause.reserve(cut.size() + 1);
+      clause.push_back(direction == POSITIVE_POLARITY ? -variables[id] : variables[id]);
+      for (std::size_t j = 0; j < cut.size(); j++) {
+        if (cube.positive & (1u << j)) {
+          clause.push_back(get_literal(cut[j], true));
+        } else if (cube.negative & (1u << j)) {
+          clause.push_back(get_literal(cut[j], false));
+        }
+      }
+      add_clause(std::move(clause));
+    }
+  }
+}
+
+std::vector<std::vector<int>> PolarityEncoder::encode(OutputPolarity polarity) {
+  assert(abc::Aig_ManCoNum(man) == 1);
+  auto output_variable = next_variable++;
+  auto co = abc::Aig_ManCo(man, 0);
+  auto driver = abc::Aig_ObjFanin0(co);
+  bool complemented = abc::Aig_ObjFaninC0(co);
+  bool positive = polarity != OutputPolarity::NEGATIVE;
+  bool negative = polarity != OutputPolarity::POSITIVE;
+  if (abc::Aig_ObjIsConst1(driver)) {
+    // The output is constant, only one of its implications is not trivial.
+    if (complemented && positive) {
+      add_clause({-output_variable});
+    } else if (!complemented && negative) {
+      add_clause({output_variable});
+    }
+    return std::move(clauses);
+  }
+  if (positive) {
+    add_clause({-output_variable, get_literal(driver, complemented)});
+  }
+  if (negative) {
+    add_clause({output_variable, get_literal(driver, !complemented)});
+  }
+  // All uses of a node come from nodes later in DFS order.
+  abc::Aig_Obj_t* pObj;
+  int i;
+  for (i = abc::Vec_PtrSize(nodes) - 1; i >= 0; i--) {
+    pObj = static_cast<abc::Aig_Obj_t*>(abc::Vec_PtrEntry(nodes, i));
+    if (polarities[abc::Aig_ObjId(pObj)] != 0) {
+      encode_node(pObj);
+    }
+  }
+  return std::move(clauses);
+}
+
+}
+
+void IncrementalCnfEncoder::set_input_variable(abc::Aig_Obj_t* ci, int variable) {
+  auto id = static_cast<std::size_t>(abc::Aig_ObjId(ci));
+  if (id >= variables.size()) {
+    variables.resize(id + 1, 0);
+  }
+  variables[id] = variable;
+}
+
+// The literal of a used node. Schedules the implications for the polarity of the use if they were
+// not emitted yet (both for Tseitin encoding).
+int IncrementalCnfEncoder::get_literal(abc::Aig_Obj_t* node, bool complemented) {
+  auto id = abc::Aig_ObjId(node);
+  if (variables[id] == 0) {
+    variables[id] = next_variable++;
+  }
+  if (abc::Aig_ObjIsNode(node)) {
+    uint8_t polarity = all_polarities ? POSITIVE_POLARITY | NEGATIVE_POLARITY : complemented ? NEGATIVE_POLARITY : POSITIVE_POLARITY;
+    uint8_t missing = polarity & ~encoded_polarities[id];
+    if (missing != 0) {
+      encoded_polarities[id] |= missing;
+      pending_nodes.emplace_back(node, missing);
+    }
+  }
+  return complemented ? -variables[id] : variables[id];
+}
+
+int IncrementalCnfEncoder::encode_output(abc::Aig_Man_t* man, abc::Aig_Obj_t* driver, const CnfEncodingConfig& config,
+                                         std::vector<std::vector<int>>& clauses, CnfEncodingStatistics& statistics) {
+  variables.resize(abc::Aig_ManObjNumMax(man), 0);
+  encoded_polarities.resize(abc::Aig_ManObjNumMax(man), 0);
+  all_polarities = config.encoding == CnfEncoding::TSEITIN;
+  auto first_variable = next_variable;
+  auto nr_clauses = clauses.size();
+  auto output_variable = next_variable++;
+  bool complemented = abc::Aig_IsComplement(driver);
+  driver = abc::Aig_Regular(driver);
+  bool positive = all_polarities || config.polarity != OutputPolarity::NEGATIVE;
+  bool negative = all_polarities || config.polarity != OutputPolarity::POSITIVE;
+  if (abc::Aig_ObjIsConst1(driver)) {
+    // The output is constant, only one of its implications is not trivial.
+    if (complemented && positive) {
+      clauses.push_back({-output_variable});
+    } else if (!complemented && negative) {
+      clauses.push_back({output_variable});
+    }
+  } else {
+    if (positive) {
+      clauses.push_back({-output_variable, get_literal(driver, complemented)});
+    }
+    if (negative) {
+      clauses.push_back({output_variable, get_literal(driver, !complemented)});
+    }
+  }
+  while (!pending_nodes.empty()) {
+    auto [node, polarity] = pending_nodes.back();
+    pending_nodes.pop_back();
+    auto variable = variables[abc::Aig_ObjId(node)];
+    auto fanin0 = abc::Aig_ObjFanin0(node);
+    auto fanin1 = abc::Aig_ObjFanin1(node);
+    bool complemented0 = abc::Aig_ObjFaninC0(node);
+    bool complemented1 = abc::Aig_ObjFaninC1(node);
+    if (polarity & POSITIVE_POLARITY) {
+      clauses.push_back({get_literal(fanin0, complemented0), -variable});
+      clauses.push_back({get_literal(fanin1, complemented1), -variable});
+    }
+    if (polarity & NEGATIVE_POLARITY) {
+      clauses.push_back({get_literal(fanin0, !complemented0), get_literal(fanin1, !complemented1), variable});
+    }
+  }
+  statistics.encodings++;
+  statistics.clauses += clauses.size() - nr_clauses;
+  for (auto clause = clauses.begin() + nr_clauses; clause != clauses.end(); clause++) {
+    statistics.literals += clause->size();
+  }
+  statistics.auxiliary_variables += next_variable - first_variable;
+  return output_variable;
+}
+
+std::vector<std::vector<int>> encode_aig(abc::Aig_Man_t* man, std::span<const int> input_variables, int auxiliary_variable_start,
+                                         const CnfEncodingConfig& config, CnfEncodingStatistics& statistics) {
+  statistics.encodings++;
+  statistics.aig_nodes += abc::Aig_ManNodeNum(man);
+  std::vector<std::vector<int>> clauses;
+  switch (config.encoding) {
+    case CnfEncoding::TSEITIN:
+      clauses = encode_tseitin(man, input_variables, auxiliary_variable_start);
+      break;
+    case CnfEncoding::PLAISTED_GREENBAUM:
+      clauses = PolarityEncoder(man, input_variables, auxiliary_variable_start, 0).encode(config.polarity);
+      break;
+    case CnfEncoding::LUT:
+      clauses = PolarityEncoder(man, input_variables, auxiliary_variable_start, std::clamp(config.lut_size, 2u, MAX_LUT_SIZE)).encode(config.polarity);
+      break;
+  }
+  int max_variable = auxiliary_variable_start - 1;
+  for (const auto& clause: clauses) {
+    statistics.literals += clause.size();
+    for (auto l: clause) {
+      if (abs(l) >= auxiliary_variable_start) {
+        max_variable = std::max(max_variable, abs(l));
+      }
+    }
+  }
+  statistics.clauses += clauses.size();
+  statistics.auxiliary_variables += max_variable - auxiliary_variable_start + 1;
+  return clauses;
+}
+
+}
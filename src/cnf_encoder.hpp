@@ -0,0 +1,76 @@
+#ifndef ITP_CNF_ENCODER_H_
+#define ITP_CNF_ENCODER_H_
+
+#include <vector>
+#include <span>
+#include <utility>
+#include <cstdint>
+
+#include "aig/aig/aig.h"
+
+namespace cadical_itp {
+
+enum class CnfEncoding {
+  TSEITIN,            // Both implications of every AND node.
+  PLAISTED_GREENBAUM, // Only the implications of each AND node needed for the polarities it is used in.
+  LUT                 // Polarity-aware clauses of cones with at most lut_size inputs, from irredundant covers.
+};
+
+// Polarities in which the caller uses the output variable.
+enum class OutputPolarity {
+  POSITIVE, // Only the output literal, e.g. when the output is asserted: the output implies the AIG.
+  NEGATIVE, // Only its negation: the AIG implies the output.
+  BOTH
+};
+
+struct CnfEncodingConfig {
+  CnfEncoding encoding = CnfEncoding::TSEITIN;
+  OutputPolarity polarity = OutputPolarity::BOTH;
+  // Maximal number of inputs of a LUT, clamped to 2 to 6.
+  unsigned lut_size = 4;
+};
+
+struct CnfEncodingStatistics {
+  uint64_t encodings = 0;
+  uint64_t aig_nodes = 0;
+  uint64_t clauses = 0;
+  uint64_t literals = 0;
+  uint64_t auxiliary_variables = 0;
+};
+
+// Encode an AIG with a single output as clauses. CI i is represented by input_variables[i], the output
+// by auxiliary_variable_start and internal nodes by the following variables. Polarity-aware encodings
+// only number the nodes they use, and are equisatisfiable with the Tseitin encoding in any formula that
+// uses the output in the configured polarities.
+std::vector<std::vector<int>> encode_aig(abc::Aig_Man_t* man, std::span<const int> input_variables, int auxiliary_variable_start,
+                                         const CnfEncodingConfig& config, CnfEncodingStatistics& statistics);
+
+// Encoder for the outputs of a growing AIG, in which every node is numbered and encoded once: each
+// output only gets clauses for the nodes (and implications) that earlier outputs did not need.
+// Polarity-aware encodings emit a missing implication once a node is used in a new polarity; LUT
+// encoding is not incremental, as merged cones change when nodes gain fanouts, and falls back to
+// Plaisted-Greenbaum.
+class IncrementalCnfEncoder {
+ public:
+  explicit IncrementalCnfEncoder(int auxiliary_variable_start): next_variable(auxiliary_variable_start), all_polarities(false) {}
+  void set_input_variable(abc::Aig_Obj_t* ci, int variable);
+  // Append the clauses of a new output with the given driver to clauses and return its variable.
+  int encode_output(abc::Aig_Man_t* man, abc::Aig_Obj_t* driver, const CnfEncodingConfig& config,
+                    std::vector<std::vector<int>>& clauses, CnfEncodingStatistics& statistics);
+  // First variable not used by the encoding so far.
+  int get_next_variable() const { return next_variable; }
+
+ private:
+  int get_literal(abc::Aig_Obj_t* node, bool complemented);
+
+  int next_variable;
+  // Indexed by object ids.
+  std::vector<int> variables;
+  std::vector<uint8_t> encoded_polarities;
+  std::vector<std::pair<abc::Aig_Obj_t*, uint8_t>> pending_nodes;
+  bool all_polarities;
+};
+
+}
+
+#endif // ITP_CNF_ENCODER_H_
@@ -1,35 +1,45 @@
 #include "definabilitychecker.hpp"
 
 #include <cassert>
+#include <array>
+#include <algorithm>
+#include <numeric>
+#include <tuple>
 
-Definabilitychecker::Definabilitychecker() : state(State::UNDEFINED) {}
+Definabilitychecker::Definabilitychecker() : state(State::UNDEFINED), frame_has_external_assumptions(false), use_definition_cache(true), definition_from_cache(false),
+  use_slicing(false), slice_stamp(0), last_query_sliced(false), use_gate_detection(false), use_direct_aig(false), gate_detector_clauses(0) {}
 
 void Definabilitychecker::add_variable(int variable) {
   assert(variable > 0);
   while (variable >= equality_selector.size()) {
     equality_selector.push_back(0);
   }
-  auto equal_selector = 5 * variable + 2;
-  auto true_selector = 5 * variable + 3;
-  auto false_selector = 5 * variable + 4;
+  auto equal_selector = 6 * variable + 2;
+  auto true_selector = 6 * variable + 3;
+  auto false_selector = 6 * variable + 4;
   equality_selector[variable] = equal_selector;
+  variable_occurrences.resize(equality_selector.size());
+  variable_marks.resize(equality_selector.size(), 0);
+  copied_variables.push_back(translate_literal(variable, true));
+  copied_variables.push_back(translate_literal(variable, false));
   auto first_part_variable = translate_literal(variable, true);
   auto second_part_variable = translate_literal(variable, false);
-  interpolator.append_formula({{-equal_selector, first_part_variable, -second_part_variable}, {-equal_selector, -first_part_variable, second_part_variable}}, false);
+  interpolator.add_clause(std::array{-equal_selector, first_part_variable, -second_part_variable}, false);
+  interpolator.add_clause(std::array{-equal_selector, -first_part_variable, second_part_variable}, false);
   // Workaround to avoid failed assumptions at decision level 0: we use -selector and 1 as an assumption. 1 is a variable that is unused.
-  interpolator.add_clause({-true_selector, -1, first_part_variable}, true);
-  interpolator.add_clause({-false_selector, -1, -second_part_variable}, false);
+  interpolator.add_clause(std::array{-true_selector, -1, first_part_variable}, true);
+  interpolator.add_clause(std::array{-false_selector, -1, -second_part_variable}, false);
 }
 
 int Definabilitychecker::translate_literal(int literal, bool first_part) {
   auto v = abs(literal);
-  auto v_translated = 5 * v + first_part;
+  auto v_translated = 6 * v + first_part;
   return literal < 0 ? -v_translated : v_translated;
 }
 
 int Definabilitychecker::original_literal(int translated_literal) {
   auto v = abs(translated_literal);
-  auto v_original = v / 5;
+  auto v_original = v / 6;
   if (v_original >= equality_selector.size()) {
     // This is an auxiliary variable introduced during interpolation.
     return translated_literal;
@@ -52,15 +62,48 @@ void Definabilitychecker::original_clause(std::vector<int>& translated_clause) {
 }
 
 void Definabilitychecker::add_clause(const std::vector<int>& clause) {
+  add_clause(std::span<const int>(clause));
+}
+
+void Definabilitychecker::add_clause(std::span<const int> clause) {
   state = State::UNDEFINED;
+  // Witnesses may violate the new clause. Committed equalities need no clearing: they are covered by
+  // the always shared differences.
+  witness_pool.clear();
+  // Translate into a reusable buffer to avoid allocating per clause.
+  translated_clause_buffer.clear();
   for (auto l: clause) {
     auto v = abs(l);
     if (v >= equality_selector.size() or equality_selector[v] == 0) {
       add_variable(v);
     }
+    translated_clause_buffer.push_back(translate_literal(l, true));
+  }
+  interpolator.add_clause(translated_clause_buffer, true);
+  // Turn the first part copy into the second part copy in place.
+  for (auto& l: translated_clause_buffer) {
+    l = l < 0 ? l + 1 : l - 1;
+  }
+  if (use_slicing) {
+    // Only the second part copy is guarded: with the complete first part, a model of a slice can be
+    // extended to the whole second part by copying the first part outside the slice.
+    auto clause_index = sliceable_clauses.size();
+    sliceable_clauses.add_clause(clause);
+    for (auto l: clause) {
+      auto& occurrences = variable_occurrences[abs(l)];
+      if (occurrences.empty() || occurrences.back() != clause_index) {
+        occurrences.push_back(clause_index);
+      }
+    }
+    clause_marks.push_back(0);
+    auto selector = clause_selector(clause_index);
+    translated_clause_buffer.push_back(-selector);
+    interpolator.add_clause(std::array{selector, -ALL_CLAUSES_SELECTOR}, false);
+  }
+  interpolator.add_clause(translated_clause_buffer, false);
+  if (use_gate_detection) {
+    gate_clauses.add_clause(clause);
   }
-  interpolator.add_clause(translate_clause(clause, true), true);
-  interpolator.add_clause(translate_clause(clause, false), false);
 }
 
 void Definabilitychecker::append_formula(const std::vector<std::vector<int>>& formula) {
@@ -69,46 +112,363 @@ void Definabilitychecker::append_formula(const std::vector<std::vector<int>>& fo
   }
 }
 
+void Definabilitychecker::append_formula(const cadical_itp::ClauseArena& formula) {
+  append_formula(formula.get_literals(), formula.get_offsets());
+}
+
+void Definabilitychecker::append_formula(std::span<const int> literals, std::span<const std::size_t> offsets) {
+  for (std::size_t i = 0; i + 1 < offsets.size(); i++) {
+    add_clause(literals.subspan(offsets[i], offsets[i + 1] - offsets[i]));
+  }
+}
+
 bool Definabilitychecker::has_definition(int variable, const std::vector<int>& shared_variables, const std::vector<int>& assumptions) {
-  assert(variable > 0);
+  auto result = check_definition(variable, shared_variables, assumptions, cadical_itp::SolveBudget{});
+  if (result == DefinabilityResult::UNKNOWN) {
+    throw cadical_itp::Interpolator::InterpolatorStateException("solver stopped at the deadline");
+  }
+  return result == DefinabilityResult::DEFINED;
+}
+
+DefinabilityResult Definabilitychecker::check_definition(int variable, const std::vector<int>& shared_variables, const std::vector<int>& assumptions, const cadical_itp::SolveBudget& budget) {
+  prepare_query_frame(shared_variables, assumptions);
+  return check_prepared_definition(variable, budget);
+}
+
+std::vector<bool> Definabilitychecker::has_definitions(const std::vector<int>& variables, const std::vector<int>& shared_variables, const std::vector<int>& assumptions) {
+  std::vector<bool> defined;
+  for (const auto& result: check_definitions(variables, shared_variables, assumptions, cadical_itp::SolveBudget{}, false)) {
+    if (result.result == DefinabilityResult::UNKNOWN) {
+      throw cadical_itp::Interpolator::InterpolatorStateException("solver stopped at the deadline");
+    }
+    defined.push_back(result.result == DefinabilityResult::DEFINED);
+  }
+  return defined;
+}
+
+std::vector<DefinitionResult> Definabilitychecker::check_definitions(const std::vector<int>& variables, const std::vector<int>& shared_variables, const std::vector<int>& assumptions,
+                                                                     const cadical_itp::SolveBudget& budget, bool with_definitions) {
+  prepare_query_frame(shared_variables, assumptions);
+  std::vector<DefinitionResult> results;
+  for (auto v: variables) {
+    results.push_back(DefinitionResult{v, DefinabilityResult::UNKNOWN, {}, 0});
+  }
+  // Neighbouring variables tend to share clauses (and learned clauses) in encodings of circuits, so
+  // query them one after the other. Each satisfiable query also adds a witness that may refute the
+  // queries after it without solving.
+  std::vector<std::size_t> order(variables.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::ranges::stable_sort(order, {}, [&variables](std::size_t i) { return variables[i]; });
+  for (auto i: order) {
+    auto& result = results[i];
+    result.result = check_prepared_definition(result.variable, budget);
+    // The proof of this query is only available until the next solve call.
+    if (with_definitions && result.result == DefinabilityResult::DEFINED) {
+      std::tie(result.definition, result.auxiliary_variable_start) = get_definition(false);
+    }
+  }
   state = State::UNDEFINED;
-  std::vector<int> assumptions_internal;
+  return results;
+}
+
+// Translate the shared variables and external assumptions once for all queries that use them.
+void Definabilitychecker::prepare_query_frame(const std::vector<int>& shared_variables, const std::vector<int>& assumptions) {
+  frame_assumptions.clear();
+  frame_shared_variables.clear();
   for (auto v: shared_variables) {
     if (v >= equality_selector.size() or equality_selector[v] == 0) {
       add_variable(v);
     }
-    assumptions_internal.push_back(equality_selector[v]);
+    if (is_committed_variable(v)) {
+      continue;
+    }
+    frame_shared_variables.push_back(v);
+    frame_assumptions.push_back(equality_selector[v]);
   }
-  auto true_selector = 5 * variable + 3;
-  auto false_selector = 5 * variable + 4;
-  // Translate external assumptions.
-  auto assumptions_first_part = translate_clause(assumptions, true);
-  assumptions_internal.insert(assumptions_internal.end(), assumptions_first_part.begin(), assumptions_first_part.end());
-  std::vector<int> assumptions_second_part = translate_clause(assumptions, false);
-  assumptions_internal.insert(assumptions_internal.end(), assumptions_second_part.begin(), assumptions_second_part.end());
-  assumptions_internal.push_back(true_selector);
-  assumptions_internal.push_back(false_selector);
-  assumptions_internal.push_back(1);
-  bool has_definition = !interpolator.solve(assumptions_internal);
-  if (has_definition) {
-    state = State::DEFINED;
-    last_shared_variables = shared_variables;
-    last_variable = variable;
+  for (auto l: assumptions) {
+    frame_assumptions.push_back(translate_literal(l, true));
   }
-  return has_definition;
+  for (auto l: assumptions) {
+    frame_assumptions.push_back(translate_literal(l, false));
+  }
+  frame_has_external_assumptions = !assumptions.empty();
+}
+
+DefinabilityResult Definabilitychecker::check_prepared_definition(int variable, const cadical_itp::SolveBudget& budget) {
+  assert(variable > 0);
+  state = State::UNDEFINED;
+  // Witnesses are models of both copies without assumptions, so they only refute queries without them.
+  if (!frame_has_external_assumptions && witness_pool.refutes(variable, frame_shared_variables)) {
+    return DefinabilityResult::NOT_DEFINED;
+  }
+  // Only queries without external assumptions can be answered from (and contribute to) the cache.
+  bool cacheable = use_definition_cache && !frame_has_external_assumptions;
+  if (cacheable) {
+    if (auto core = definition_cache.lookup(variable, frame_shared_variables, is_committed)) {
+      state = State::DEFINED;
+      last_shared_variables = *core;
+      last_variable = variable;
+      definition_from_cache = true;
+      return DefinabilityResult::DEFINED;
+    }
+  }
+  auto true_selector = 6 * variable + 3;
+  auto false_selector = 6 * variable + 4;
+  query_assumptions.assign(frame_assumptions.begin(), frame_assumptions.end());
+  last_query_sliced = false;
+  if (!sliceable_clauses.empty()) {
+    if (use_slicing) {
+      add_slice_assumptions(variable, frame_shared_variables, query_assumptions);
+    } else {
+      query_assumptions.push_back(ALL_CLAUSES_SELECTOR);
+    }
+  }
+  query_assumptions.push_back(true_selector);
+  query_assumptions.push_back(false_selector);
+  query_assumptions.push_back(1);
+  auto result = interpolator.solve(query_assumptions, budget);
+  if (result == cadical_itp::SolveResult::UNKNOWN) {
+    return DefinabilityResult::UNKNOWN;
+  } else if (result == cadical_itp::SolveResult::SAT) {
+    record_witness();
+    return DefinabilityResult::NOT_DEFINED;
+  }
+  if (cacheable) {
+    // The failed equality selectors form a defining core.
+    std::vector<int> core;
+    for (auto l: interpolator.get_failed()) {
+      if (l > 2 && l % 6 == 2) {
+        core.push_back(l / 6);
+      }
+    }
+    definition_cache.insert(variable, std::move(core));
+  }
+  state = State::DEFINED;
+  last_shared_variables = frame_shared_variables;
+  last_variable = variable;
+  definition_from_cache = false;
+  return DefinabilityResult::DEFINED;
 }
 
-std::pair<std::vector<std::vector<int>>, int> Definabilitychecker::get_definition(bool rewrite) {
+std::pair<std::vector<std::vector<int>>, int> Definabilitychecker::get_definition(bool rewrite, cadical_itp::InterpolationSystem system) {
   if (state != State::DEFINED) {
     throw UndefinedException();
   }
   state = State::UNDEFINED; // Can we make sure that repeated calls of get_definition are safe?
-  auto [output_variable, definition] = interpolator.get_interpolant(translate_clause(last_shared_variables, true), 5 * equality_selector.size(), false);
+  if (definition_from_cache) {
+    // The solver did not run for this query: derive the conflict again, restricted to the cached core.
+    std::vector<int> core_assumptions;
+    for (auto v: last_shared_variables) {
+      if (!is_committed_variable(v)) {
+        core_assumptions.push_back(equality_selector[v]);
+      }
+    }
+    if (!sliceable_clauses.empty()) {
+      core_assumptions.push_back(ALL_CLAUSES_SELECTOR);
+    }
+    core_assumptions.push_back(6 * last_variable + 3);
+    core_assumptions.push_back(6 * last_variable + 4);
+    core_assumptions.push_back(1);
+    if (interpolator.solve(core_assumptions)) {
+      throw cadical_itp::Interpolator::InterpolatorStateException("cached defining core is not unsatisfiable");
+    }
+    std::erase_if(last_shared_variables, [this](int v) { return is_committed_variable(v); });
+  }
+  // Committed variables are shared as well. In direct mode, all shared variables of the frame are, so that
+  // the interpolants cached for one definition stay valid for the next; a definition may then also use
+  // shared variables outside its defining core.
+  std::vector<int> shared_variables(committed_shared_variables);
+  const auto& definition_variables = use_direct_aig ? frame_shared_variables : last_shared_variables;
+  shared_variables.insert(shared_variables.end(), definition_variables.begin(), definition_variables.end());
+  auto [output_variable, definition] = interpolator.get_interpolant(translate_clause(shared_variables, true), 6 * equality_selector.size(), rewrite, system);
   for (auto& clause: definition) {
     original_clause(clause);
   }
   definition.push_back({ output_variable, -last_variable});
   definition.push_back({-output_variable,  last_variable});
-  return std::make_pair(definition, 5 * equality_selector.size());
+  return std::make_pair(definition, 6 * equality_selector.size());
+}
+
+std::optional<std::pair<std::vector<std::vector<int>>, int>> Definabilitychecker::find_gate_definition(int variable, const std::vector<int>& shared_variables) {
+  if (gate_clauses.empty()) {
+    return std::nullopt;
+  }
+  if (!gate_detector || gate_detector_clauses != gate_clauses.size()) {
+    gate_detector = std::make_unique<cadical_itp::GateDetector>(gate_clauses);
+    gate_detector_clauses = gate_clauses.size();
+  }
+  for (auto v: shared_variables) {
+    if (v >= gate_inputs.size()) {
+      gate_inputs.resize(v + 1, false);
+    }
+    gate_inputs[v] = true;
+  }
+  auto gate = gate_detector->find_gate(variable, gate_inputs);
+  for (auto v: shared_variables) {
+    gate_inputs[v] = is_committed_variable(v);
+  }
+  if (!gate) {
+    return std::nullopt;
+  }
+  // The gate clauses only contain original variables, so no auxiliary variables are used.
+  return std::make_pair(gate_detector->get_definition(*gate), 6 * static_cast<int>(equality_selector.size()));
 }
 
+// Add the model of the last (satisfiable) query to the witness pool.
+void Definabilitychecker::record_witness() {
+  if (!witness_pool.enabled()) {
+    return;
+  }
+  auto values = interpolator.get_values(copied_variables);
+  differing_variables.clear();
+  for (std::size_t i = 0; i < values.size(); i += 2) {
+    if ((values[i] > 0) != (values[i + 1] > 0)) {
+      auto v = original_literal(copied_variables[i]);
+      // Outside the slice the second part copy is replaced by the first part copy, which satisfies all clauses.
+      if (!last_query_sliced || variable_marks[v] == slice_stamp) {
+        differing_variables.push_back(v);
+      }
+    }
+  }
+  witness_pool.add(differing_variables, is_committed);
+}
+
+// Assume the selectors of the clauses reachable from variable through non-shared variables.
+// Slices covering more than half of the clauses activate all of them with a single assumption instead.
+void Definabilitychecker::add_slice_assumptions(int variable, const std::vector<int>& shared_variables, std::vector<int>& assumptions) {
+  slice_statistics.queries++;
+  if (++slice_stamp == 0) {
+    std::ranges::fill(clause_marks, 0);
+    std::ranges::fill(variable_marks, 0);
+    slice_stamp = 1;
+  }
+  // Shared variables bound the slice. Committed variables are checked while searching instead,
+  // so queries do not need to visit all of them.
+  for (auto v: shared_variables) {
+    variable_marks[v] = slice_stamp;
+  }
+  variable_marks[variable] = slice_stamp;
+  slice_stack.assign(1, variable);
+  slice_selectors.clear();
+  auto max_slice_size = sliceable_clauses.size() / 2;
+  while (!slice_stack.empty()) {
+    auto v = slice_stack.back();
+    slice_stack.pop_back();
+    for (auto clause_index: variable_occurrences[v]) {
+      if (clause_marks[clause_index] == slice_stamp) {
+        continue;
+      }
+      clause_marks[clause_index] = slice_stamp;
+      slice_selectors.push_back(clause_selector(clause_index));
+      if (slice_selectors.size() > max_slice_size) {
+        slice_statistics.active_clauses += sliceable_clauses.size();
+        assumptions.push_back(ALL_CLAUSES_SELECTOR);
+        return;
+      }
+      for (auto l: sliceable_clauses[clause_index]) {
+        auto u = abs(l);
+        if (variable_marks[u] != slice_stamp && !is_committed_variable(u)) {
+          variable_marks[u] = slice_stamp;
+          slice_stack.push_back(u);
+        }
+      }
+    }
+  }
+  slice_statistics.sliced++;
+  slice_statistics.active_clauses += slice_selectors.size();
+  assumptions.insert(assumptions.end(), slice_selectors.begin(), slice_selectors.end());
+  last_query_sliced = true;
+}
+
+void Definabilitychecker::commit_shared_variables(std::span<const int> variables) {
+  state = State::UNDEFINED;
+  for (auto v: variables) {
+    assert(v > 0);
+    if (v >= equality_selector.size() or equality_selector[v] == 0) {
+      add_variable(v);
+    }
+    if (v >= is_committed.size()) {
+      is_committed.resize(v + 1, false);
+    }
+    if (is_committed[v]) {
+      continue;
+    }
+    is_committed[v] = true;
+    if (v >= gate_inputs.size()) {
+      gate_inputs.resize(v + 1, false);
+    }
+    gate_inputs[v] = true;
+    committed_shared_variables.push_back(v);
+    witness_pool.add_always_shared(v);
+    // A unit on the equality selector belongs to the second part, like the equality clauses it enables.
+    interpolator.add_clause(std::array{equality_selector[v]}, false);
+  }
+}
+
+void Definabilitychecker::set_definition_cache(bool enabled) {
+  use_definition_cache = enabled;
+  if (!enabled) {
+    definition_cache.clear();
+  }
+}
+
+void Definabilitychecker::set_trusted_replay(bool trusted_replay) {
+  interpolator.set_trusted_replay(trusted_replay);
+}
+
+void Definabilitychecker::set_replay_threads(unsigned nr_threads) {
+  interpolator.set_replay_threads(nr_threads);
+}
+
+void Definabilitychecker::set_cancellation_token(std::shared_ptr<cadical_itp::CancellationToken> token) {
+  interpolator.set_cancellation_token(std::move(token));
+}
+
+void Definabilitychecker::set_deadline(std::chrono::steady_clock::time_point deadline) {
+  interpolator.set_deadline(deadline);
+}
+
+void Definabilitychecker::clear_deadline() {
+  interpolator.clear_deadline();
+}
+
+void Definabilitychecker::set_gc_watermark(std::size_t bytes) {
+  interpolator.set_gc_watermark(bytes);
+}
+
+void Definabilitychecker::set_aig_optimization(const cadical_itp::AigOptimizationConfig& config) {
+  interpolator.set_aig_optimization(config);
+}
+
+const cadical_itp::AigOptimizationStatistics& Definabilitychecker::get_aig_optimization_statistics() const {
+  return interpolator.get_aig_optimization_statistics();
+}
+
+void Definabilitychecker::set_proof_compression(double seconds) {
+  interpolator.set_proof_compression(seconds);
+}
+
+const cadical_itp::ProofCompressionStatistics& Definabilitychecker::get_proof_compression_statistics() const {
+  return interpolator.get_proof_compression_statistics();
+}
+
+void Definabilitychecker::set_cnf_encoding(const cadical_itp::CnfEncodingConfig& config) {
+  interpolator.set_cnf_encoding(config);
+}
+
+const cadical_itp::CnfEncodingStatistics& Definabilitychecker::get_cnf_encoding_statistics() const {
+  return interpolator.get_cnf_encoding_statistics();
+}
+
+void Definabilitychecker::set_shared_aig(bool shared_aig) {
+  interpolator.set_shared_aig(shared_aig);
+}
+
+void Definabilitychecker::set_direct_aig(bool direct_aig) {
+  use_direct_aig = direct_aig;
+  interpolator.set_direct_aig(direct_aig);
+}
+
+const cadical_itp::ProofCacheGCStatistics& Definabilitychecker::get_gc_statistics() const {
+  return interpolator.get_gc_statistics();
+}
@@ -2,9 +2,16 @@
 #define DEFINABILITYCHECKER_H_
 
 #include "interpolator.hpp"
+#include "definition_cache.hpp"
+#include "witness_pool.hpp"
+#include "gate_detector.hpp"
 
 #include <vector>
+#include <span>
+#include <memory>
+#include <optional>
 #include <utility>
+#include <cstdint>
 
 // Define exception thrown when get_definition is called in undefined state.
 class UndefinedException : public std::exception {
@@ -14,13 +21,87 @@ class UndefinedException : public std::exception {
   }
 };
 
+enum class DefinabilityResult {
+  DEFINED,
+  NOT_DEFINED,
+  UNKNOWN // The budget was exhausted.
+};
+
+// Outcome of one query of a batch.
+struct DefinitionResult {
+  int variable;
+  DefinabilityResult result;
+  // The definition as returned by get_definition, if definitions were requested and the variable is defined.
+  std::vector<std::vector<int>> definition;
+  int auxiliary_variable_start;
+};
+
 class Definabilitychecker {
  public:
+  struct SliceStatistics {
+    uint64_t queries = 0;
+    // Queries solved on a slice instead of the whole second part.
+    uint64_t sliced = 0;
+    uint64_t active_clauses = 0;
+  };
+
   Definabilitychecker();
   void add_clause(const std::vector<int>& clause);
+  void add_clause(std::span<const int> clause);
   void append_formula(const std::vector<std::vector<int>>& formula);
+  void append_formula(const cadical_itp::ClauseArena& formula);
+  void append_formula(std::span<const int> literals, std::span<const std::size_t> offsets);
   bool has_definition(int variable, const std::vector<int>& shared_variables, const std::vector<int>& assumptions);
-  std::pair<std::vector<std::vector<int>>, int> get_definition(bool rewrite);
+  DefinabilityResult check_definition(int variable, const std::vector<int>& shared_variables, const std::vector<int>& assumptions, const cadical_itp::SolveBudget& budget);
+  std::pair<std::vector<std::vector<int>>, int> get_definition(bool rewrite, cadical_itp::InterpolationSystem system = cadical_itp::InterpolationSystem::MCMILLAN);
+  // Check several variables against the same shared variables and assumptions, which are translated only once.
+  // Results are in the order of variables; definitions are extracted right after each query if requested.
+  // Leaves the checker in UNDEFINED state.
+  std::vector<DefinitionResult> check_definitions(const std::vector<int>& variables, const std::vector<int>& shared_variables, const std::vector<int>& assumptions,
+                                                  const cadical_itp::SolveBudget& budget, bool with_definitions);
+  std::vector<bool> has_definitions(const std::vector<int>& variables, const std::vector<int>& shared_variables, const std::vector<int>& assumptions);
+  // Monotone shared set: the given variables become shared in all following queries. Their equalities
+  // are asserted permanently, so they no longer need to be passed (and assumed) in every query.
+  void commit_shared_variables(std::span<const int> variables);
+  // Answer queries without external assumptions from the defining cores of earlier queries (on by default).
+  void set_definition_cache(bool enabled);
+  const DefinitionCache::Statistics& get_cache_statistics() const { return definition_cache.get_statistics(); }
+  // Number of models of satisfiable queries kept to refute later queries without solving (0 disables).
+  void set_witness_pool_size(std::size_t size) { witness_pool.set_capacity(size); }
+  const WitnessPool::Statistics& get_witness_statistics() const { return witness_pool.get_statistics(); }
+  // Only activate the second part copies of the clauses connected to the queried variable through
+  // non-shared variables (off by default). Applies to the clauses added afterwards.
+  void set_slicing(bool enabled) { use_slicing = enabled; }
+  const SliceStatistics& get_slice_statistics() const { return slice_statistics; }
+  // Keep the original clauses to find Tseitin gates in them (off by default). Applies to the clauses added afterwards.
+  void set_gate_detection(bool enabled) { use_gate_detection = enabled; }
+  // If variable is the output of a gate over shared and committed variables, return the clauses of the gate
+  // in the format of get_definition, without solving. Does not change the state of the checker.
+  std::optional<std::pair<std::vector<std::vector<int>>, int>> find_gate_definition(int variable, const std::vector<int>& shared_variables);
+  void set_trusted_replay(bool trusted_replay);
+  void set_replay_threads(unsigned nr_threads);
+  void set_cancellation_token(std::shared_ptr<cadical_itp::CancellationToken> token);
+  void set_deadline(std::chrono::steady_clock::time_point deadline);
+  void clear_deadline();
+  void set_gc_watermark(std::size_t bytes);
+  const cadical_itp::ProofCacheGCStatistics& get_gc_statistics() const;
+  // Optimization script for definitions requested with get_definition(true).
+  void set_aig_optimization(const cadical_itp::AigOptimizationConfig& config);
+  const cadical_itp::AigOptimizationStatistics& get_aig_optimization_statistics() const;
+  // Time limit for compressing the proof of a definition (0: no compression).
+  void set_proof_compression(double seconds);
+  const cadical_itp::ProofCompressionStatistics& get_proof_compression_statistics() const;
+  // Encoding of definitions. The output polarity refers to the polarities in which the defined variable is used.
+  void set_cnf_encoding(const cadical_itp::CnfEncodingConfig& config);
+  const cadical_itp::CnfEncodingStatistics& get_cnf_encoding_statistics() const;
+  // Build all definitions in one shared AIG. Each definition then only contains the clauses of logic
+  // not encoded by earlier definitions, so the definitions have to be used together.
+  void set_shared_aig(bool shared_aig);
+  // Build definitions while replaying the proof and keep the interpolants of derived clauses between
+  // definitions (off by default). They are only reused while the committed and shared variables stay
+  // the same, e.g. for the variables of one check_definitions call or repeated queries with the same
+  // shared variables: any change, including a growing prefix, drops them.
+  void set_direct_aig(bool direct_aig);
 
  protected:
   enum class State {
@@ -34,11 +115,57 @@ class Definabilitychecker {
   int original_literal(int translated_literal);
   std::vector<int> translate_clause(const std::vector<int>& clause, bool first_part);
   void original_clause(std::vector<int>& translated_clause);
+  bool is_committed_variable(int variable) const { return variable < is_committed.size() && is_committed[variable]; }
+  void record_witness();
+  void prepare_query_frame(const std::vector<int>& shared_variables, const std::vector<int>& assumptions);
+  DefinabilityResult check_prepared_definition(int variable, const cadical_itp::SolveBudget& budget);
+  void add_slice_assumptions(int variable, const std::vector<int>& shared_variables, std::vector<int>& assumptions);
+  // The selector of the i-th sliceable clause uses the free slot of variable i + 1.
+  static int clause_selector(std::size_t clause) { return 6 * static_cast<int>(clause + 1) + 5; }
+  // The free slot of variable 0 activates all sliceable clauses.
+  static constexpr int ALL_CLAUSES_SELECTOR = 5;
 
   cadical_itp::Interpolator interpolator;
   std::vector<int> equality_selector;
+  std::vector<int> translated_clause_buffer;
   std::vector<int> last_shared_variables;
+  // Translated assumptions and non-committed shared variables of the current queries.
+  std::vector<int> frame_assumptions;
+  std::vector<int> frame_shared_variables;
+  bool frame_has_external_assumptions;
+  std::vector<int> query_assumptions;
+  std::vector<int> committed_shared_variables;
+  std::vector<bool> is_committed;
+  DefinitionCache definition_cache;
+  bool use_definition_cache;
+  // The last query was answered by the cache, so the solver is not in an UNSAT state for it.
+  bool definition_from_cache;
+  WitnessPool witness_pool;
+  // Both copies of every original variable, as pairs (first part, second part).
+  std::vector<int> copied_variables;
+  std::vector<int> differing_variables;
+  bool use_slicing;
+  // Original clauses whose second part copy is guarded by a clause selector, with their occurrences by variable.
+  cadical_itp::ClauseArena sliceable_clauses;
+  std::vector<std::vector<std::size_t>> variable_occurrences;
+  // Clauses and variables of the current slice are marked with slice_stamp.
+  std::vector<uint32_t> clause_marks;
+  std::vector<uint32_t> variable_marks;
+  uint32_t slice_stamp;
+  std::vector<int> slice_stack;
+  std::vector<int> slice_selectors;
+  // The last query was solved on a slice, so the second part copy of its model only satisfies the slice.
+  bool last_query_sliced;
+  SliceStatistics slice_statistics;
   int last_variable;
+  bool use_gate_detection;
+  bool use_direct_aig;
+  cadical_itp::ClauseArena gate_clauses;
+  // Built on demand, and again once clauses have been added.
+  std::unique_ptr<cadical_itp::GateDetector> gate_detector;
+  std::size_t gate_detector_clauses;
+  // Committed variables, and the shared variables during find_gate_definition.
+  std::vector<bool> gate_inputs;
 };
 
 #endif /* DEFINABILITYCHECKER_H_ */
\ No newline at end of file
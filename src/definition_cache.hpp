@@ -0,0 +1,96 @@
+#ifndef DEFINITION_CACHE_H_
+#define DEFINITION_CACHE_H_
+
+#include <vector>
+#include <span>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+
+// Minimal defining cores per variable. A core is a set of shared variables that defines the
+// variable. Definability is monotone in the shared set, so a variable is defined by every shared
+// set containing one of its cores. Only cores that are minimal w.r.t. inclusion are kept.
+class DefinitionCache {
+ public:
+  struct Statistics {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t inserted = 0;
+    // Cores dropped because a smaller one was found.
+    uint64_t subsumed = 0;
+  };
+
+  // Returns a core of variable contained in shared_variables (plus the variables flagged in
+  // always_shared), or nullptr.
+  const std::vector<int>* lookup(int variable, std::span<const int> shared_variables, const std::vector<bool>& always_shared);
+  void insert(int variable, std::vector<int> core);
+  void clear() { cores.clear(); }
+  const Statistics& get_statistics() const { return statistics; }
+
+ private:
+  void mark(std::span<const int> variables, bool value);
+  bool is_subset(const std::vector<int>& core, const std::vector<bool>& always_shared) const;
+
+  std::unordered_map<int, std::vector<std::vector<int>>> cores;
+  std::vector<bool> marks;
+  Statistics statistics;
+};
+
+inline void DefinitionCache::mark(std::span<const int> variables, bool value) {
+  for (auto v: variables) {
+    if (v >= marks.size()) {
+      marks.resize(v + 1, false);
+    }
+    marks[v] = value;
+  }
+}
+
+inline bool DefinitionCache::is_subset(const std::vector<int>& core, const std::vector<bool>& always_shared) const {
+  return std::all_of(core.begin(), core.end(), [&](int v) {
+    return (v < marks.size() && marks[v]) || (v < always_shared.size() && always_shared[v]);
+  });
+}
+
+inline const std::vector<int>* DefinitionCache::lookup(int variable, std::span<const int> shared_variables, const std::vector<bool>& always_shared) {
+  auto it = cores.find(variable);
+  if (it == cores.end()) {
+    statistics.misses++;
+    return nullptr;
+  }
+  mark(shared_variables, true);
+  const std::vector<int>* result = nullptr;
+  for (const auto& core: it->second) {
+    if (is_subset(core, always_shared)) {
+      result = &core;
+      break;
+    }
+  }
+  mark(shared_variables, false);
+  if (result) {
+    statistics.hits++;
+  } else {
+    statistics.misses++;
+  }
+  return result;
+}
+
+inline void DefinitionCache::insert(int variable, std::vector<int> core) {
+  std::sort(core.begin(), core.end());
+  core.erase(std::unique(core.begin(), core.end()), core.end());
+  auto& variable_cores = cores[variable];
+  for (const auto& other: variable_cores) {
+    if (std::includes(core.begin(), core.end(), other.begin(), other.end())) {
+      // Subsumed by a core we already have.
+      return;
+    }
+  }
+  auto nr_cores = variable_cores.size();
+  std::erase_if(variable_cores, [&core](const std::vector<int>& other) {
+    return std::includes(other.begin(), other.end(), core.begin(), core.end());
+  });
+  statistics.subsumed += nr_cores - variable_cores.size();
+  variable_cores.push_back(std::move(core));
+  statistics.inserted++;
+}
+
+#endif // DEFINITION_CACHE_H_
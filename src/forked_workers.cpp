@@ -0,0 +1,159 @@
+#include "forked_workers.hpp"
+
+#include <vector>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace cadical_itp {
+
+namespace {
+
+void write_all(int fd, const char* data, std::size_t size) {
+  while (size > 0) {
+    auto written = write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      _exit(1);
+    }
+    data += written;
+    size -= written;
+  }
+}
+
+// Body of a worker process. Never returns.
+[[noreturn]] void run_worker(int fd, unsigned worker, std::size_t begin, std::size_t end, std::size_t record_size,
+                             const std::function<void(unsigned, std::size_t, void*)>& run_task) {
+  int status = 0;
+  try {
+    // Each record is prefixed by its task index.
+    std::vector<char> record(sizeof(uint64_t) + record_size);
+    for (auto task = begin; task < end; task++) {
+      uint64_t task_index = task;
+      std::memcpy(record.data(), &task_index, sizeof(task_index));
+      run_task(worker, task, record.data() + sizeof(uint64_t));
+      write_all(fd, record.data(), record.size());
+    }
+  } catch (...) {
+    status = 1;
+  }
+  close(fd);
+  // Skip destructors and exit handlers: they belong to the parent's state.
+  _exit(status);
+}
+
+// Close the pipes that are still open and kill and reap the workers, after an error in the parent.
+void stop_workers(const std::vector<pid_t>& pids, std::vector<pollfd>& pipes) {
+  for (auto& pipe: pipes) {
+    if (pipe.fd >= 0) {
+      close(pipe.fd);
+      pipe.fd = -1;
+    }
+  }
+  for (auto pid: pids) {
+    kill(pid, SIGKILL);
+  }
+  for (auto pid: pids) {
+    while (waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {}
+  }
+}
+
+}
+
+void run_forked_workers(unsigned nr_workers, std::size_t nr_tasks, std::size_t record_size,
+                        const std::function<void(unsigned worker, std::size_t task, void* record)>& run_task,
+                        const std::function<void(std::size_t task, const void* record)>& receive) {
+  // Buffered output would otherwise be written once by every worker.
+  std::fflush(nullptr);
+  std::vector<pid_t> pids;
+  std::vector<pollfd> pipes;
+  try {
+    for (unsigned worker = 0; worker < nr_workers; worker++) {
+      int fds[2];
+      if (pipe(fds) != 0) {
+        throw ForkedWorkerException(std::string("could not create pipe: ") + std::strerror(errno));
+      }
+      auto pid = fork();
+      if (pid < 0) {
+        auto error = errno;
+        close(fds[0]);
+        close(fds[1]);
+        throw ForkedWorkerException(std::string("could not fork worker: ") + std::strerror(error));
+      }
+      if (pid == 0) {
+        close(fds[0]);
+        for (auto& other: pipes) {
+          close(other.fd);
+        }
+        run_worker(fds[1], worker, nr_tasks * worker / nr_workers, nr_tasks * (worker + 1) / nr_workers, record_size, run_task);
+      }
+      close(fds[1]);
+      pids.push_back(pid);
+      pipes.push_back(pollfd{fds[0], POLLIN, 0});
+    }
+
+    // Collect records as they arrive.
+    auto full_record_size = sizeof(uint64_t) + record_size;
+    std::vector<std::vector<char>> buffers(nr_workers);
+    std::vector<char> chunk(1 << 16);
+    unsigned nr_open = nr_workers;
+    while (nr_open > 0) {
+      if (poll(pipes.data(), pipes.size(), -1) < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw ForkedWorkerException(std::string("could not poll workers: ") + std::strerror(errno));
+      }
+      for (unsigned worker = 0; worker < nr_workers; worker++) {
+        auto& pipe = pipes[worker];
+        if (pipe.fd < 0 || !(pipe.revents & (POLLIN | POLLHUP | POLLERR))) {
+          continue;
+        }
+        auto nr_read = read(pipe.fd, chunk.data(), chunk.size());
+        if (nr_read < 0 && errno == EINTR) {
+          continue;
+        }
+        if (nr_read <= 0) {
+          close(pipe.fd);
+          pipe.fd = -1;
+          nr_open--;
+          continue;
+        }
+        auto& buffer = buffers[worker];
+        buffer.insert(buffer.end(), chunk.begin(), chunk.begin() + nr_read);
+        std::size_t offset = 0;
+        for (; offset + full_record_size <= buffer.size(); offset += full_record_size) {
+          uint64_t task;
+          std::memcpy(&task, buffer.data() + offset, sizeof(task));
+          receive(task, buffer.data() + offset + sizeof(uint64_t));
+        }
+        buffer.erase(buffer.begin(), buffer.begin() + offset);
+      }
+    }
+  } catch (...) {
+    // Do not leave running workers or open pipes behind, e.g. when receive is interrupted.
+    stop_workers(pids, pipes);
+    throw;
+  }
+
+  unsigned nr_failed = 0;
+  for (auto pid: pids) {
+    int status;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      nr_failed++;
+    }
+  }
+  if (nr_failed > 0) {
+    throw ForkedWorkerException(std::to_string(nr_failed) + " worker process(es) failed");
+  }
+}
+
+}
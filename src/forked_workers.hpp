@@ -0,0 +1,56 @@
+#ifndef ITP_FORKED_WORKERS_H_
+#define ITP_FORKED_WORKERS_H_
+
+#include <functional>
+#include <string>
+#include <exception>
+#include <type_traits>
+#include <cstddef>
+#include <cstring>
+
+namespace cadical_itp {
+
+class ForkedWorkerException: public std::exception {
+ public:
+  explicit ForkedWorkerException(const std::string& message): message(message) {}
+
+  const char* what() const noexcept override {
+    return message.c_str();
+  }
+
+ private:
+  std::string message;
+};
+
+// Run tasks 0..nr_tasks-1 in nr_workers forked processes. The workers share all memory of the
+// calling process copy-on-write, so state that is expensive to build (e.g. a loaded
+// Definabilitychecker) is built once before the call and is instantly available in every worker.
+// Worker w handles the w-th contiguous slice of tasks. It calls run_task(worker, task, record)
+// for each of them and streams the fixed-size record back over a pipe, where the calling
+// process passes it to receive(task, record) as it arrives.
+// The calling process must not run other threads, and workers must not touch the terminal.
+// Throws ForkedWorkerException if a worker process fails.
+void run_forked_workers(unsigned nr_workers, std::size_t nr_tasks, std::size_t record_size,
+                        const std::function<void(unsigned worker, std::size_t task, void* record)>& run_task,
+                        const std::function<void(std::size_t task, const void* record)>& receive);
+
+template <typename Result>
+void run_forked_workers(unsigned nr_workers, std::size_t nr_tasks,
+                        const std::function<Result(unsigned worker, std::size_t task)>& run_task,
+                        const std::function<void(std::size_t task, const Result& result)>& receive) {
+  static_assert(std::is_trivially_copyable_v<Result>, "results are sent as raw bytes");
+  run_forked_workers(nr_workers, nr_tasks, sizeof(Result),
+    [&run_task](unsigned worker, std::size_t task, void* record) {
+      auto result = run_task(worker, task);
+      std::memcpy(record, &result, sizeof(Result));
+    },
+    [&receive](std::size_t task, const void* record) {
+      Result result;
+      std::memcpy(&result, record, sizeof(Result));
+      receive(task, result);
+    });
+}
+
+}
+
+#endif // ITP_FORKED_WORKERS_H_
@@ -0,0 +1,182 @@
+#include "gate_detector.hpp"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <cstdlib>
+
+namespace cadical_itp {
+
+GateDetector::GateDetector(const ClauseArena& formula): formula(formula), mark_stamp(0) {
+  int max_variable = 0;
+  for (auto l: formula.get_literals()) {
+    max_variable = std::max(max_variable, std::abs(l));
+  }
+  auto nr_literals = literal_index(-max_variable) + 1;
+  // Counting sort of the clause indices by literal.
+  occurrence_offsets.assign(nr_literals + 1, 0);
+  for (auto l: formula.get_literals()) {
+    occurrence_offsets[literal_index(l) + 1]++;
+  }
+  for (std::size_t i = 0; i < nr_literals; i++) {
+    occurrence_offsets[i + 1] += occurrence_offsets[i];
+  }
+  occurrence_lists.resize(formula.nr_literals());
+  std::vector<std::size_t> positions(occurrence_offsets.begin(), occurrence_offsets.end() - 1);
+  for (std::size_t i = 0; i < formula.size(); i++) {
+    for (auto l: formula[i]) {
+      occurrence_lists[positions[literal_index(l)]++] = i;
+    }
+  }
+  marks.assign(nr_literals, 0);
+  marked_clauses.assign(nr_literals, NO_CLAUSE);
+}
+
+std::span<const std::size_t> GateDetector::occurrences(int literal) const {
+  auto i = literal_index(literal);
+  if (i + 1 >= occurrence_offsets.size()) {
+    return {};
+  }
+  return std::span<const std::size_t>(occurrence_lists.data() + occurrence_offsets[i], occurrence_offsets[i + 1] - occurrence_offsets[i]);
+}
+
+bool GateDetector::is_input_literal(int literal, int output, const std::vector<bool>& is_input) const {
+  auto v = std::abs(literal);
+  return v != std::abs(output) && static_cast<std::size_t>(v) < is_input.size() && is_input[v];
+}
+
+std::size_t GateDetector::find_ternary_clause(int a, int b, int c) const {
+  auto candidates = occurrences(a);
+  for (auto l: {b, c}) {
+    if (occurrences(l).size() < candidates.size()) {
+      candidates = occurrences(l);
+    }
+  }
+  for (auto i: candidates) {
+    auto clause = formula[i];
+    if (clause.size() == 3 && std::ranges::find(clause, a) != clause.end() && std::ranges::find(clause, b) != clause.end() &&
+        std::ranges::find(clause, c) != clause.end()) {
+      return i;
+    }
+  }
+  return NO_CLAUSE;
+}
+
+// A clause (o | l_1 | ... | l_n) together with the binary clauses (-o | -l_i) encodes o <-> AND(-l_i).
+std::optional<Gate> GateDetector::find_and_gate(int output, const std::vector<bool>& is_input) {
+  for (auto o: {output, -output}) {
+    if (++mark_stamp == 0) {
+      std::ranges::fill(marks, 0);
+      mark_stamp = 1;
+    }
+    for (auto i: occurrences(-o)) {
+      auto clause = formula[i];
+      if (clause.size() != 2) {
+        continue;
+      }
+      auto other = clause[0] == -o ? clause[1] : clause[0];
+      marks[literal_index(other)] = mark_stamp;
+      marked_clauses[literal_index(other)] = i;
+    }
+    for (auto i: occurrences(o)) {
+      auto clause = formula[i];
+      bool is_gate = std::ranges::all_of(clause, [&](int l) {
+        return l == o || (is_input_literal(l, o, is_input) && marks[literal_index(-l)] == mark_stamp);
+      });
+      if (!is_gate) {
+        continue;
+      }
+      Gate gate{clause.size() == 1 ? GateType::CONSTANT : clause.size() == 2 ? GateType::EQUIVALENCE : GateType::AND, o, {}, {i}};
+      for (auto l: clause) {
+        if (l != o) {
+          gate.inputs.push_back(-l);
+          gate.clauses.push_back(marked_clauses[literal_index(-l)]);
+        }
+      }
+      return gate;
+    }
+  }
+  return std::nullopt;
+}
+
+// The clauses (y | x | r), (-y | x | -r), (y | -x | s), (-y | -x | -s) encode y <-> (-x ? -r : -s).
+// XOR gates are the special case s = -r.
+std::optional<Gate> GateDetector::find_ite_gate(int output, const std::vector<bool>& is_input) const {
+  auto is_candidate = [&](std::span<const int> clause) {
+    return clause.size() == 3 && std::ranges::count_if(clause, [&](int l) { return std::abs(l) == output; }) == 1;
+  };
+  auto other_literals = [output](std::span<const int> clause) {
+    std::array<int, 2> literals;
+    std::ranges::copy_if(clause, literals.begin(), [output](int l) { return l != output; });
+    return literals;
+  };
+  for (auto i: occurrences(output)) {
+    auto clause = formula[i];
+    if (!is_candidate(clause)) {
+      continue;
+    }
+    auto [p, q] = other_literals(clause);
+    for (auto [x, r]: {std::pair{p, q}, std::pair{q, p}}) {
+      if (std::abs(x) == std::abs(r) || !is_input_literal(x, output, is_input) || !is_input_literal(r, output, is_input)) {
+        continue;
+      }
+      auto then_clause = find_ternary_clause(-output, x, -r);
+      if (then_clause == NO_CLAUSE) {
+        continue;
+      }
+      for (auto j: occurrences(-x)) {
+        auto else_clause = formula[j];
+        if (j == i || !is_candidate(else_clause) || std::ranges::find(else_clause, output) == else_clause.end()) {
+          continue;
+        }
+        auto [u, w] = other_literals(else_clause);
+        auto s = u == -x ? w : u;
+        if (std::abs(s) == std::abs(x) || !is_input_literal(s, output, is_input)) {
+          continue;
+        }
+        auto negated_else_clause = find_ternary_clause(-output, -x, -s);
+        if (negated_else_clause == NO_CLAUSE) {
+          continue;
+        }
+        std::vector<std::size_t> clauses{i, then_clause, j, negated_else_clause};
+        if (s == -r) {
+          return Gate{GateType::XOR, output, {x, -r}, std::move(clauses)};
+        }
+        return Gate{GateType::ITE, output, {-x, -r, -s}, std::move(clauses)};
+      }
+    }
+  }
+  return std::nullopt;
+}
+
+std::optional<Gate> GateDetector::find_gate(int variable, const std::vector<bool>& is_input) {
+  auto gate = find_and_gate(variable, is_input);
+  if (!gate) {
+    gate = find_ite_gate(variable, is_input);
+  }
+  if (gate) {
+    count(*gate);
+  }
+  return gate;
+}
+
+void GateDetector::count(const Gate& gate) {
+  switch (gate.type) {
+    case GateType::CONSTANT: statistics.constants++; break;
+    case GateType::EQUIVALENCE: statistics.equivalences++; break;
+    case GateType::AND: statistics.and_gates++; break;
+    case GateType::XOR: statistics.xor_gates++; break;
+    case GateType::ITE: statistics.ite_gates++; break;
+  }
+}
+
+std::vector<std::vector<int>> GateDetector::get_definition(const Gate& gate) const {
+  std::vector<std::vector<int>> definition;
+  for (auto i: gate.clauses) {
+    auto clause = formula[i];
+    definition.emplace_back(clause.begin(), clause.end());
+  }
+  return definition;
+}
+
+}
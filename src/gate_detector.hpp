@@ -0,0 +1,77 @@
+#ifndef ITP_GATE_DETECTOR_H_
+#define ITP_GATE_DETECTOR_H_
+
+#include <vector>
+#include <span>
+#include <optional>
+#include <cstddef>
+#include <cstdint>
+
+#include "clause_arena.hpp"
+
+namespace cadical_itp {
+
+enum class GateType {
+  CONSTANT,    // Unit clause.
+  EQUIVALENCE, // output <-> input
+  AND,         // output <-> AND(inputs); OR gates are AND gates of the negated output.
+  XOR,         // output <-> XOR(inputs)
+  ITE          // output <-> (inputs[0] ? inputs[1] : inputs[2])
+};
+
+struct Gate {
+  GateType type;
+  // Output and inputs are literals, so negations are part of the gate.
+  int output;
+  std::vector<int> inputs;
+  // Indices of the clauses of the formula that encode the gate.
+  std::vector<std::size_t> clauses;
+};
+
+// Finds Tseitin-encoded gates among the clauses of a formula with occurrence lists.
+// The clauses of a gate alone imply that its output is a function of its inputs, so they are a
+// definition of the output variable regardless of the rest of the formula.
+class GateDetector {
+ public:
+  struct Statistics {
+    uint64_t constants = 0;
+    uint64_t equivalences = 0;
+    uint64_t and_gates = 0;
+    uint64_t xor_gates = 0;
+    uint64_t ite_gates = 0;
+  };
+
+  // The formula must outlive the detector.
+  explicit GateDetector(const ClauseArena& formula);
+  // Find a gate with the given output variable whose input variables v all have is_input[v] set.
+  std::optional<Gate> find_gate(int variable, const std::vector<bool>& is_input);
+  // The clauses of the gate, in the format of Definabilitychecker::get_definition.
+  std::vector<std::vector<int>> get_definition(const Gate& gate) const;
+  const Statistics& get_statistics() const { return statistics; }
+
+ private:
+  static constexpr std::size_t NO_CLAUSE = static_cast<std::size_t>(-1);
+
+  static std::size_t literal_index(int literal) { return 2 * static_cast<std::size_t>(literal < 0 ? -literal : literal) + (literal < 0); }
+  std::span<const std::size_t> occurrences(int literal) const;
+  bool is_input_literal(int literal, int output, const std::vector<bool>& is_input) const;
+  // Index of a ternary clause consisting of the given literals, or NO_CLAUSE.
+  std::size_t find_ternary_clause(int a, int b, int c) const;
+  std::optional<Gate> find_and_gate(int output, const std::vector<bool>& is_input);
+  std::optional<Gate> find_ite_gate(int output, const std::vector<bool>& is_input) const;
+  void count(const Gate& gate);
+
+  const ClauseArena& formula;
+  // Clause indices of literal l at occurrence_lists[occurrence_offsets[i]..occurrence_offsets[i+1]) for i = literal_index(l).
+  std::vector<std::size_t> occurrence_lists;
+  std::vector<std::size_t> occurrence_offsets;
+  // Binary clause partner of each literal, valid if marks[i] == mark_stamp.
+  std::vector<uint32_t> marks;
+  std::vector<std::size_t> marked_clauses;
+  uint32_t mark_stamp;
+  Statistics statistics;
+};
+
+}
+
+#endif // ITP_GATE_DETECTOR_H_
@@ -0,0 +1,225 @@
+#ifndef ITP_ID_TABLE_H_
+#define ITP_ID_TABLE_H_
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <limits>
+
+namespace cadical_itp {
+
+// One bit per clause id.
+class IdBitmap {
+ public:
+  void set(uint64_t id, bool value);
+  bool get(uint64_t id) const;
+  void reserve(uint64_t nr_ids) { words.reserve((nr_ids >> 6) + 1); }
+
+ private:
+  std::vector<uint64_t> words;
+};
+
+inline void IdBitmap::set(uint64_t id, bool value) {
+  auto word = id >> 6;
+  if (word >= words.size()) {
+    words.resize(word + 1, 0);
+  }
+  auto mask = uint64_t(1) << (id & 63);
+  if (value) {
+    words[word] |= mask;
+  } else {
+    words[word] &= ~mask;
+  }
+}
+
+inline bool IdBitmap::get(uint64_t id) const {
+  auto word = id >> 6;
+  return word < words.size() && ((words[word] >> (id & 63)) & 1);
+}
+
+// Per-clause-id interpolation state: a 32-bit value (proof node index or AIG literal)
+// and an epoch stamp used as visited marker when traversing the proof.
+// Clause ids are dense, so entries live in fixed-size pages indexed by id.
+// A page is allocated on first use and released once it holds no value. Pages that only hold
+// visited stamps are released at the end of the traversal.
+class ClauseIdTable {
+ public:
+  static constexpr uint32_t EMPTY = std::numeric_limits<uint32_t>::max();
+
+  uint32_t get(uint64_t id) const;
+  bool contains(uint64_t id) const { return get(id) != EMPTY; }
+  void set(uint64_t id, uint32_t value);
+  void erase(uint64_t id);
+  // Start a new traversal; all ids become unvisited.
+  void new_epoch();
+  // Mark id as visited in the current epoch. Returns false if it was visited already.
+  bool visit(uint64_t id);
+  // Finish the traversal and release the pages that were only allocated for visited stamps.
+  void end_epoch();
+  // Number of clause ids with a value.
+  std::size_t size() const { return nr_live; }
+  bool empty() const { return nr_live == 0; }
+  void clear();
+  // Call function(value) for every stored value.
+  template <typename Function>
+  void for_each_value(Function function) const;
+  // Replace every stored value by function(value), which must not return EMPTY.
+  template <typename Function>
+  void transform_values(Function function);
+  // Bytes held by the table.
+  std::size_t memory_usage() const { return pages.capacity() * sizeof(Page) + nr_allocated_pages * PAGE_SIZE * sizeof(Entry); }
+
+ private:
+  static constexpr unsigned PAGE_BITS = 12;
+  static constexpr uint64_t PAGE_SIZE = uint64_t(1) << PAGE_BITS;
+
+  struct Entry {
+    uint32_t value;
+    uint32_t epoch;
+  };
+
+  struct Page {
+    std::unique_ptr<Entry[]> entries;
+    uint32_t nr_live = 0;
+  };
+
+  Entry& get_entry(uint64_t id);
+
+  std::vector<Page> pages;
+  std::size_t nr_live = 0;
+  std::size_t nr_allocated_pages = 0;
+  uint32_t epoch = 0;
+  // Pages allocated by visit in the current epoch.
+  std::vector<uint64_t> visited_pages;
+};
+
+inline uint32_t ClauseIdTable::get(uint64_t id) const {
+  auto page = id >> PAGE_BITS;
+  if (page >= pages.size() || !pages[page].entries) {
+    return EMPTY;
+  }
+  return pages[page].entries[id & (PAGE_SIZE - 1)].value;
+}
+
+inline ClauseIdTable::Entry& ClauseIdTable::get_entry(uint64_t id) {
+  auto page = id >> PAGE_BITS;
+  if (page >= pages.size()) {
+    pages.resize(page + 1);
+  }
+  auto& entries = pages[page].entries;
+  if (!entries) {
+    entries.reset(new Entry[PAGE_SIZE]);
+    nr_allocated_pages++;
+    for (uint64_t i = 0; i < PAGE_SIZE; i++) {
+      entries[i] = Entry{EMPTY, 0};
+    }
+  }
+  return entries[id & (PAGE_SIZE - 1)];
+}
+
+inline void ClauseIdTable::set(uint64_t id, uint32_t value) {
+  auto& entry = get_entry(id);
+  if (entry.value == EMPTY) {
+    pages[id >> PAGE_BITS].nr_live++;
+    nr_live++;
+  }
+  entry.value = value;
+}
+
+inline void ClauseIdTable::erase(uint64_t id) {
+  auto page_index = id >> PAGE_BITS;
+  if (page_index >= pages.size() || !pages[page_index].entries) {
+    return;
+  }
+  auto& page = pages[page_index];
+  auto& entry = page.entries[id & (PAGE_SIZE - 1)];
+  if (entry.value == EMPTY) {
+    return;
+  }
+  entry.value = EMPTY;
+  nr_live--;
+  if (--page.nr_live == 0) {
+    page.entries.reset();
+    nr_allocated_pages--;
+  }
+}
+
+inline void ClauseIdTable::end_epoch() {
+  for (auto page_index: visited_pages) {
+    auto& page = pages[page_index];
+    if (page.entries && page.nr_live == 0) {
+      page.entries.reset();
+      nr_allocated_pages--;
+    }
+  }
+  visited_pages.clear();
+}
+
+inline void ClauseIdTable::new_epoch() {
+  end_epoch();
+  if (epoch == std::numeric_limits<uint32_t>::max()) {
+    // Wrap around: clear all stamps.
+    for (auto& page: pages) {
+      if (page.entries) {
+        for (uint64_t i = 0; i < PAGE_SIZE; i++) {
+          page.entries[i].epoch = 0;
+        }
+      }
+    }
+    epoch = 0;
+  }
+  epoch++;
+}
+
+inline bool ClauseIdTable::visit(uint64_t id) {
+  auto page = id >> PAGE_BITS;
+  if (page >= pages.size() || !pages[page].entries) {
+    visited_pages.push_back(page);
+  }
+  auto& entry = get_entry(id);
+  if (entry.epoch == epoch) {
+    return false;
+  }
+  entry.epoch = epoch;
+  return true;
+}
+
+inline void ClauseIdTable::clear() {
+  pages.clear();
+  visited_pages.clear();
+  nr_live = 0;
+  nr_allocated_pages = 0;
+}
+
+template <typename Function>
+void ClauseIdTable::for_each_value(Function function) const {
+  for (const auto& page: pages) {
+    if (!page.entries) {
+      continue;
+    }
+    for (uint64_t i = 0; i < PAGE_SIZE; i++) {
+      if (page.entries[i].value != EMPTY) {
+        function(page.entries[i].value);
+      }
+    }
+  }
+}
+
+template <typename Function>
+void ClauseIdTable::transform_values(Function function) {
+  for (auto& page: pages) {
+    if (!page.entries) {
+      continue;
+    }
+    for (uint64_t i = 0; i < PAGE_SIZE; i++) {
+      auto& value = page.entries[i].value;
+      if (value != EMPTY) {
+        value = function(value);
+      }
+    }
+  }
+}
+
+}
+
+#endif // ITP_ID_TABLE_H_
@@ -2,39 +2,71 @@
 
 #include <cassert>
 #include <algorithm>
-#include <iostream>
+#include <atomic>
+#include <chrono>
 #include <string>
+#include <thread>
 
-#include "opt/dar/dar.h"
 
 using namespace abc; // Needed for macro expansion.
 
 namespace cadical_itp {
 
-Interpolator::Interpolator(): state(State::UNDEFINED), aig_man(nullptr) {
-  abc::Dar_LibStart();
+namespace {
+
+// Derived clauses are replayed in batches, handed out to threads in blocks.
+constexpr std::size_t REPLAY_BATCH_SIZE = 1 << 16;
+constexpr std::size_t REPLAY_BLOCK_SIZE = 256;
+// Smaller cores are replayed sequentially.
+constexpr std::size_t MIN_PARALLEL_REPLAY_SIZE = 4 * REPLAY_BLOCK_SIZE;
+// Proofnodes of deleted clauses are reclaimed once the arena has doubled, but not below this size.
+constexpr std::size_t MIN_PROOFNODE_RECLAIM_SIZE = std::size_t(1) << 16;
+
+// Encode an AIG object (including its complement bit) as a 32-bit literal.
+uint32_t aig_literal(abc::Aig_Obj_t* node) {
+  return 2 * abc::Aig_ObjId(abc::Aig_Regular(node)) + abc::Aig_IsComplement(node);
+}
+
+abc::Aig_Obj_t* aig_node_from_literal(abc::Aig_Man_t* man, uint32_t literal) {
+  return abc::Aig_NotCond(abc::Aig_ManObj(man, literal >> 1), literal & 1);
+}
+
+// Releases the Proofnodes created after its construction when it goes out of scope, also on exceptions.
+class ProofnodeTruncation {
+ public:
+  explicit ProofnodeTruncation(ProofnodeArena& proofnodes): proofnodes(proofnodes), size(proofnodes.size()) {}
+  ~ProofnodeTruncation() { proofnodes.truncate(size); }
+  ProofnodeTruncation(const ProofnodeTruncation&) = delete;
+  ProofnodeTruncation& operator=(const ProofnodeTruncation&) = delete;
+
+ private:
+  ProofnodeArena& proofnodes;
+  std::size_t size;
+};
+
+}
+
+Interpolator::Interpolator(): state(State::UNDEFINED), replay_threads(1), trusted_replay(false), aig_epoch(0), proofnode_reclaim_threshold(MIN_PROOFNODE_RECLAIM_SIZE), aig_man(nullptr), interpolation_system(InterpolationSystem::MCMILLAN), direct_aig(false), replay_aig_man(nullptr), gc_watermark(0), gc_threshold(0), proof_compression_seconds(0), shared_aig(false), shared_aig_man(nullptr), shared_aig_variable_start(0) {
+  acquire_dar_library();
 }
 
 Interpolator::~Interpolator() {
-  abc::Dar_LibStop();
+  if (replay_aig_man) {
+    abc::Aig_ManStop(replay_aig_man);
+  }
+  reset_shared_aig();
+  release_dar_library();
 }
 
-void Interpolator::add_clause(const std::vector<int>& clause, bool first_part) {
+void Interpolator::add_clause(std::span<const int> clause, bool first_part) {
   state = State::UNDEFINED;
   auto id = solver.get_current_clause_id() + 1;
   solver.add_clause(clause);
-  id_in_first_part[id] = first_part;
+  id_in_first_part.set(id, first_part);
   for (auto l: clause) {
     auto v = abs(l);
-    if (v >= is_assigned.size()) {
-      is_assigned.reserve(v + 1);
-      reason.reserve(v + 1);
-      variable_seen.reserve(v + 1);
-    }
-    while(v >= is_assigned.size()) {
-      is_assigned.push_back(false);
-      reason.push_back(0);
-      variable_seen.push_back(false);
+    if (v >= replay_context.variables.size()) {
+      replay_context.resize(v + 1);
     }
     if (first_part) {
       first_part_variables_set.insert(v);
@@ -42,18 +74,17 @@ void Interpolator::add_clause(const std::vector<int>& clause, bool first_part) {
   }
 }
 
-std::vector<uint64_t> Interpolator::get_core() const {
+std::vector<uint64_t> Interpolator::get_core() {
   std::vector<uint64_t> core;
   std::vector<uint64_t> id_queue = {solver.get_latest_id()};
-  std::unordered_set<uint64_t> seen;
+  clause_id_to_proofnode.new_epoch();
   while (!id_queue.empty()) {
     auto id = id_queue.back();
     id_queue.pop_back();
-    if (seen.contains(id)) {
+    if (!clause_id_to_proofnode.visit(id)) {
       continue;
     }
-    seen.insert(id);
-    if (!solver.is_initial_clause(id) && !clause_id_to_proofnode.contains(id)) {
+    if (!solver.is_initial_clause(id) && !has_interpolant(id)) {
       core.push_back(id);
       for (auto premise_id: solver.get_premises(id)) {
         assert(premise_id < id);
@@ -61,22 +92,33 @@ std::vector<uint64_t> Interpolator::get_core() const {
       }
     }
   }
+  clause_id_to_proofnode.end_epoch();
   return core;
 }
 
-std::pair<std::vector<int>, std::shared_ptr<Proofnode>> Interpolator::analyze_and_interpolate(uint64_t id) {
+std::vector<int> Interpolator::get_clause(uint64_t id) const {
+  auto clause = solver.get_clause(id);
+  return std::vector<int>(clause.begin(), clause.end());
+}
+
+bool Interpolator::has_interpolant(uint64_t id) const {
+  return direct_aig ? clause_id_to_aig_literal.contains(id) : clause_id_to_proofnode.contains(id);
+}
+
+// Appends the resolution chain deriving the clause to steps.
+std::vector<int> Interpolator::analyze(ReplayContext& context, uint64_t id, std::vector<ResolutionStep>& steps) const {
+  auto& [variables, trail] = context;
   std::vector<int> derived_clause;
   std::vector<int> variables_seen_vector;
-  std::shared_ptr<Proofnode> interpolant_proofnode = get_proofnode(id);
-  std::string interpolant_string = std::to_string(id);
   int abs_pivot = 0;
   while (id) {
-    auto& premise = solver.get_clause(id);
+    auto premise = solver.get_clause(id);
     for (auto l: premise) {
-      if (!variable_seen[abs(l)]) {
-        variable_seen[abs(l)] = true;
+      auto& variable = variables[abs(l)];
+      if (!variable.seen) {
+        variable.seen = true;
         variables_seen_vector.push_back(abs(l));
-        if (reason[abs(l)] == 0) {
+        if (variable.reason == 0) {
           derived_clause.push_back(l);
         }
       }
@@ -86,13 +128,13 @@ std::pair<std::vector<int>, std::shared_ptr<Proofnode>> Interpolator::analyze_an
       int pivot = trail.back();
       trail.pop_back();
       abs_pivot = abs(pivot);
-      is_assigned[abs_pivot] = false;
+      auto& variable = variables[abs_pivot];
+      variable.assigned = false;
 
-      if (variable_seen[abs_pivot]) {
-        const auto& r = reason[abs_pivot];
+      if (variable.seen) {
+        const auto& r = variable.reason;
         if (r) {
-          auto reason_proofnode = get_proofnode(r);
-          interpolant_proofnode = std::make_shared<Proofnode>(abs_pivot, interpolant_proofnode, reason_proofnode);
+          steps.push_back({pivot, r});
           id = r;
           break;
         }
@@ -101,52 +143,130 @@ std::pair<std::vector<int>, std::shared_ptr<Proofnode>> Interpolator::analyze_an
   }
   assert(trail.empty());
   for (auto v: variables_seen_vector) {
-    variable_seen[v] = false;
+    variables[v].seen = false;
   }
-  return std::make_pair(derived_clause, interpolant_proofnode);
+  return derived_clause;
 }
 
 void Interpolator::replay_proof(std::vector<uint64_t>& core) {
   std::sort(core.begin(), core.end());
+  auto nr_threads = replay_threads ? replay_threads : std::max(1u, std::thread::hardware_concurrency());
+  if (nr_threads > 1 && core.size() >= MIN_PARALLEL_REPLAY_SIZE) {
+    replay_proof_parallel(core, nr_threads);
+    return;
+  }
   for (auto id: core) {
-    auto conflict_id = propagate(id);
+    auto conflict_id = propagate(replay_context, id);
     assert(conflict_id > 0);
-    auto [derived_clause, proofnode_interpolant] = analyze_and_interpolate(conflict_id);
-    assert(contains(derived_clause, solver.get_clause(id)));
-    clause_id_to_proofnode[id] = proofnode_interpolant;
+    resolution_steps.clear();
+    auto derived_clause = analyze(replay_context, conflict_id, resolution_steps);
+    assert(contains(derived_clause, get_clause(id)));
+    add_replayed_clause(id, conflict_id, resolution_steps);
   }
 }
 
-uint64_t Interpolator::propagate(uint64_t id) {
-  auto& clause = solver.get_clause(id);
+// The RUP check and chain analysis of a derived clause only read clauses and premises from the solver,
+// so clauses are analyzed concurrently with per-thread scratch state. Interpolants are then built
+// sequentially in the order of the core, which yields exactly the same result as sequential replay.
+void Interpolator::replay_proof_parallel(const std::vector<uint64_t>& core, unsigned nr_threads) {
+  std::vector<ReplayContext> contexts(nr_threads);
+  std::vector<std::vector<ResolutionStep>> step_buffers(nr_threads);
+  std::vector<ReplayedChain> chains;
+  for (auto& context: contexts) {
+    context.resize(replay_context.variables.size());
+  }
+  for (std::size_t batch_begin = 0; batch_begin < core.size(); batch_begin += REPLAY_BATCH_SIZE) {
+    auto batch_end = std::min(batch_begin + REPLAY_BATCH_SIZE, core.size());
+    chains.resize(batch_end - batch_begin);
+    std::atomic<std::size_t> next_block(batch_begin);
+    auto worker = [&](unsigned thread) {
+      auto& context = contexts[thread];
+      auto& steps = step_buffers[thread];
+      steps.clear();
+      while (true) {
+        auto block_begin = next_block.fetch_add(REPLAY_BLOCK_SIZE);
+        if (block_begin >= batch_end) {
+          break;
+        }
+        auto block_end = std::min(block_begin + REPLAY_BLOCK_SIZE, batch_end);
+        for (auto position = block_begin; position < block_end; position++) {
+          auto id = core[position];
+          auto conflict_id = propagate(context, id);
+          assert(conflict_id > 0);
+          auto steps_begin = steps.size();
+          auto derived_clause = analyze(context, conflict_id, steps);
+          assert(contains(derived_clause, get_clause(id)));
+          chains[position - batch_begin] = ReplayedChain{conflict_id, thread, steps_begin, steps.size() - steps_begin};
+        }
+      }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned thread = 1; thread < nr_threads; thread++) {
+      threads.emplace_back(worker, thread);
+    }
+    worker(0);
+    for (auto& thread: threads) {
+      thread.join();
+    }
+    for (auto position = batch_begin; position < batch_end; position++) {
+      const auto& chain = chains[position - batch_begin];
+      std::span<const ResolutionStep> steps(step_buffers[chain.thread].data() + chain.begin, chain.size);
+      add_replayed_clause(core[position], chain.conflict_id, steps);
+    }
+  }
+}
+
+void Interpolator::add_replayed_clause(uint64_t id, uint64_t conflict_id, std::span<const ResolutionStep> steps) {
+  if (direct_aig) {
+    clause_id_to_aig_literal.set(id, aig_literal(build_aig_node(conflict_id, steps)));
+  } else {
+    clause_id_to_proofnode.set(id, build_proofnode(conflict_id, steps));
+  }
+}
+
+uint64_t Interpolator::propagate(ReplayContext& context, uint64_t id) const {
+  auto& [variables, trail] = context;
+  auto clause = solver.get_clause(id);
 
   assert(trail.empty());
   for (auto l: clause) {
     trail.push_back(-l);
-    is_assigned[abs(l)] = true;
-    reason[abs(l)] = 0;
+    auto& variable = variables[abs(l)];
+    variable.assigned = true;
+    variable.reason = 0;
   }
 
   assert(!solver.is_initial_clause(id));
-  auto& premise_ids = solver.get_premises(id);
+  auto premise_ids = solver.get_premises(id);
   
   for (auto premise_id: premise_ids) {
-    auto& premise = solver.get_clause(premise_id);
+    auto premise = solver.get_clause(premise_id);
 
     int nr_unassigned = 0;
     int unassigned_literal = 0;
-    for (auto l: premise) {
-      if (!is_assigned[abs(l)]) {
-        // We could also just break here and trust the proof.
-        nr_unassigned++;
-        unassigned_literal = l;
+    if (trusted_replay) {
+      // Trust the proof: the first unassigned literal is the implied one.
+      for (auto l: premise) {
+        if (!variables[abs(l)].assigned) {
+          nr_unassigned = 1;
+          unassigned_literal = l;
+          break;
+        }
+      }
+    } else {
+      for (auto l: premise) {
+        if (!variables[abs(l)].assigned) {
+          nr_unassigned++;
+          unassigned_literal = l;
+        }
       }
+      assert(nr_unassigned <= 1);
     }
-    assert(nr_unassigned <= 1);
     if (nr_unassigned == 1) {
       trail.push_back(unassigned_literal);
-      is_assigned[abs(unassigned_literal)] = true;
-      reason[abs(unassigned_literal)] = premise_id;
+      auto& variable = variables[abs(unassigned_literal)];
+      variable.assigned = true;
+      variable.reason = premise_id;
     } else {
       return premise_id;
     }
@@ -157,205 +277,515 @@ uint64_t Interpolator::propagate(uint64_t id) {
 void Interpolator::delete_clauses() {
   for (auto id: solver.get_delete_ids()) {
     clause_id_to_proofnode.erase(id);
+    clause_id_to_aig_literal.erase(id);
   }
   solver.clear_delete_ids();
+  if (clause_id_to_proofnode.empty()) {
+    // No cached proof node is reachable anymore.
+    proofnodes.clear();
+    std::vector<StampedAigNode>().swap(proofnode_to_aig_node);
+  }
+  auto memory_usage = get_proof_cache_memory_usage();
+  gc_statistics.peak_bytes = std::max(gc_statistics.peak_bytes, memory_usage);
+  // Without a watermark, the arena is still collected in bulk whenever it has doubled, so the
+  // Proofnodes of deleted clauses do not accumulate over the lifetime of the interpolator.
+  if ((gc_threshold > 0 && memory_usage > gc_threshold) || proofnodes.size() > proofnode_reclaim_threshold) {
+    collect_garbage();
+  }
 }
 
-std::shared_ptr<Proofnode> Interpolator::get_proofnode(uint64_t id) {
-  if (clause_id_to_proofnode.contains(id)) {
-    return clause_id_to_proofnode.at(id);
+void Interpolator::set_gc_watermark(std::size_t bytes) {
+  gc_watermark = bytes;
+  gc_threshold = bytes;
+}
+
+std::size_t Interpolator::get_proof_cache_memory_usage() const {
+  auto memory_usage = proofnodes.memory_usage() + clause_id_to_proofnode.memory_usage() + clause_id_to_aig_literal.memory_usage();
+  if (replay_aig_man) {
+    memory_usage += abc::Aig_ManObjNumMax(replay_aig_man) * sizeof(abc::Aig_Obj_t);
+  }
+  return memory_usage;
+}
+
+// Reclaim Proofnodes and AIG nodes that are not reachable from the cached interpolants of live clauses.
+void Interpolator::collect_garbage() {
+  auto start = std::chrono::steady_clock::now();
+  if (proofnodes.size() > 0) {
+    std::vector<ProofnodeIndex> roots;
+    roots.reserve(clause_id_to_proofnode.size());
+    clause_id_to_proofnode.for_each_value([&roots](uint32_t index) { roots.push_back(index); });
+    auto nr_proofnodes = proofnodes.size();
+    auto forwarding = proofnodes.compact(roots);
+    clause_id_to_proofnode.transform_values([&forwarding](uint32_t index) { return forwarding[index]; });
+    gc_statistics.reclaimed_proofnodes += nr_proofnodes - proofnodes.size();
+    std::vector<StampedAigNode>().swap(proofnode_to_aig_node);
+  }
+  proofnode_reclaim_threshold = std::max(MIN_PROOFNODE_RECLAIM_SIZE, 2 * proofnodes.size());
+  if (replay_aig_man) {
+    compact_replay_aig();
+  }
+  gc_statistics.collections++;
+  gc_statistics.live_bytes = get_proof_cache_memory_usage();
+  gc_statistics.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  // If most of the data is live, wait until it has doubled instead of collecting on every call.
+  if (gc_watermark > 0) {
+    gc_threshold = std::max(gc_watermark, 2 * gc_statistics.live_bytes);
+  }
+}
+
+void Interpolator::reset_proof_cache() {
+  clause_id_to_proofnode.clear();
+  proofnodes.clear();
+  std::vector<StampedAigNode>().swap(proofnode_to_aig_node);
+  proofnode_reclaim_threshold = MIN_PROOFNODE_RECLAIM_SIZE;
+  clause_id_to_aig_literal.clear();
+  if (replay_aig_man) {
+    abc::Aig_ManStop(replay_aig_man);
+    replay_aig_man = nullptr;
+  }
+}
+
+void Interpolator::set_replay_threads(unsigned nr_threads) {
+  replay_threads = nr_threads;
+}
+
+void Interpolator::set_trusted_replay(bool trusted_replay) {
+  this->trusted_replay = trusted_replay;
+}
+
+void Interpolator::set_direct_aig(bool direct_aig) {
+  if (direct_aig != this->direct_aig) {
+    reset_proof_cache();
+    this->direct_aig = direct_aig;
+  }
+}
+
+ProofnodeIndex Interpolator::get_proofnode(uint64_t id) {
+  auto cached_proofnode = clause_id_to_proofnode.get(id);
+  if (cached_proofnode != NO_PROOFNODE) {
+    return cached_proofnode;
   }
   // If there is no Proofnode for this id, it has to be an original clause.
   assert(solver.is_initial_clause(id));
-  assert(id_in_first_part.contains(id));
-  if (id_in_first_part.at(id)) {
-    auto& clause = solver.get_clause(id);
-    // Create a Proofnode representing the clause.
-    std::shared_ptr<Proofnode> clause_output = nullptr;
-    for (auto l: clause) {
-      auto literal_node = std::make_shared<Proofnode>(l, nullptr, nullptr);
-      clause_output = std::make_shared<Proofnode>(0, clause_output, literal_node);
+  ProofnodeIndex clause_output;
+  // The literals of second part clauses are only needed by some interpolation systems,
+  // but Proofnodes are shared by all of them.
+  clause_output = proofnodes.create_clause(solver.get_clause(id), id_in_first_part.get(id));
+  clause_id_to_proofnode.set(id, clause_output);
+  return clause_output;
+}
+
+ProofnodeIndex Interpolator::build_proofnode(uint64_t conflict_id, std::span<const ResolutionStep> steps) {
+  auto start = get_proofnode(conflict_id);
+  // Look up all antecedents first, as this may create clause nodes.
+  chain_pivots.clear();
+  chain_antecedents.clear();
+  for (const auto& step: steps) {
+    chain_pivots.push_back(step.pivot);
+    chain_antecedents.push_back(get_proofnode(step.antecedent));
+  }
+  return proofnodes.create_chain(start, chain_pivots, chain_antecedents);
+}
+
+void Interpolator::set_shared_variables(const std::vector<int>& shared_variables) {
+  variable_to_ci.clear();
+  aig_input_variables.clear();
+  shared_variables_set.clear();
+  shared_variables_set.insert(shared_variables.begin(), shared_variables.end());
+}
+
+abc::Aig_Obj_t* Interpolator::get_literal_aig_node(abc::Aig_Man_t* man, int literal) {
+  auto variable = abs(literal);
+  if (!shared_variables_set.contains(variable)) {
+    // Literals local to the first part are dropped.
+    return abc::Aig_ManConst0(man);
+  }
+  // If the variable is shared and no CI has been created, create a CI node.
+  auto it = variable_to_ci.find(variable);
+  if (it == variable_to_ci.end()) {
+    aig_input_variables.push_back(variable);
+    it = variable_to_ci.emplace(variable, abc::Aig_ObjCreateCi(man)).first;
+  }
+  // Negate variable if necessary.
+  return abc::Aig_NotCond(it->second, literal < 0);
+}
+
+Interpolator::ResolutionOperator Interpolator::get_resolution_operator(int pivot) const {
+  auto variable = abs(pivot);
+  if (shared_variables_set.contains(variable)) {
+    switch (interpolation_system) {
+      case InterpolationSystem::PUDLAK:
+        return ResolutionOperator::MUX;
+      case InterpolationSystem::DUAL_MCMILLAN:
+        return ResolutionOperator::OR;
+      default:
+        return ResolutionOperator::AND;
     }
-    clause_id_to_proofnode[id] = clause_output;
-  } else {
-    // If it is in the second part, return a constant 1 node.
-    clause_id_to_proofnode[id] = std::make_shared<Proofnode>(0, nullptr, nullptr);
   }
-  return clause_id_to_proofnode.at(id);
+  // Pivots local to the first part (label a) yield an OR node, pivots local to the second part (label b) an AND node.
+  return first_part_variables_set.contains(variable) ? ResolutionOperator::OR : ResolutionOperator::AND;
 }
 
-std::vector<std::vector<int>> Interpolator::get_interpolant_clauses(std::shared_ptr<Proofnode>& rootnode, const std::vector<int>& shared_variables, int auxiliary_variable_start, bool rewrite_aig) {
-  // Create an AIG manager.
-  aig_man = abc::Aig_ManStart(shared_variables.size());
-  construct_aig(rootnode, shared_variables);
-  Aig_ManCleanup(aig_man);
-  if (abc::Aig_ManNodeNum(aig_man) > 0 && rewrite_aig) {
-    std::cout << "Number of nodes before: " << Aig_ManNodeNum(aig_man) << std::endl;
-    aig_man = Dar_ManRewriteDefault(aig_man);
-    std::cout << "Number of nodes after: " << Aig_ManNodeNum(aig_man) << std::endl;
+// Combine operands into a balanced AND or OR tree. Consumes the operands.
+abc::Aig_Obj_t* Interpolator::balance_aig_nodes(abc::Aig_Man_t* man, std::vector<abc::Aig_Obj_t*>& operands, bool conjunction) {
+  if (operands.empty()) {
+    return conjunction ? abc::Aig_ManConst1(man) : abc::Aig_ManConst0(man);
   }
-  std::vector<std::vector<int>> interpolant_clauses;
-  interpolant_clauses.reserve(proofnode_to_aig_node.size());
-  abc::Vec_Ptr_t * vNodes;
-  abc::Aig_Obj_t * pObj, * pConst1 = NULL;
-  int i;
-  assert(abc::Aig_ManCoNum(aig_man) == 1);
-  // check if constant is used
-  Aig_ManForEachCo( aig_man, pObj, i) {
-    if (abc::Aig_ObjIsConst1(abc::Aig_ObjFanin0(pObj)))
-      pConst1 = abc::Aig_ManConst1(aig_man);
-  }
-  // Assign shared variables to CIs.
-  Aig_ManForEachCi( aig_man, pObj, i) {
-    pObj->iData = aig_input_variables[i];
-  }
-  // collect nodes in the DFS order
-  vNodes = abc::Aig_ManDfs(aig_man, 1);
-  // assign IDs to objects
-  Aig_ManForEachCo( aig_man, pObj, i ) {
-    pObj->iData = auxiliary_variable_start++;
-  }
-  abc::Aig_ManConst1(aig_man)->iData = auxiliary_variable_start++;
-  Vec_PtrForEachEntry( abc::Aig_Obj_t *, vNodes, pObj, i ) {
-    pObj->iData = auxiliary_variable_start++;
+  while (operands.size() > 1) {
+    std::size_t nr_combined = 0;
+    for (std::size_t i = 0; i + 1 < operands.size(); i += 2) {
+      operands[nr_combined++] = conjunction ? abc::Aig_And(man, operands[i], operands[i + 1]) : abc::Aig_Or(man, operands[i], operands[i + 1]);
+    }
+    if (operands.size() % 2) {
+      operands[nr_combined++] = operands.back();
+    }
+    operands.resize(nr_combined);
+  }
+  return operands.front();
+}
+
+// Interpolant of a resolution chain. Maximal runs of AND or OR steps are associative, so each run
+// becomes one balanced tree instead of a left-deep spine. MUX steps end a run.
+abc::Aig_Obj_t* Interpolator::resolve_chain(abc::Aig_Man_t* man, abc::Aig_Obj_t* start, std::span<const int> pivots, std::span<abc::Aig_Obj_t* const> antecedents) {
+  aig_operands.clear();
+  aig_operands.push_back(start);
+  auto run_operator = ResolutionOperator::MUX;
+  for (std::size_t i = 0; i < pivots.size(); i++) {
+    auto step_operator = get_resolution_operator(pivots[i]);
+    if (step_operator != run_operator && aig_operands.size() > 1) {
+      auto run_output = balance_aig_nodes(man, aig_operands, run_operator == ResolutionOperator::AND);
+      aig_operands.assign(1, run_output);
+    }
+    run_operator = step_operator;
+    if (step_operator == ResolutionOperator::MUX) {
+      // (p | I_antecedent) & (-p | I_resolvent), as the antecedent contains the pivot literal p and the resolvent its negation.
+      aig_operands.front() = abc::Aig_Mux(man, get_literal_aig_node(man, pivots[i]), aig_operands.front(), antecedents[i]);
+    } else {
+      aig_operands.push_back(antecedents[i]);
+    }
+  }
+  return balance_aig_nodes(man, aig_operands, run_operator == ResolutionOperator::AND);
+}
+
+// Partial interpolant of an original clause: the disjunction of its literals labeled b for a clause of
+// the first part, the negated disjunction of its literals labeled a for a clause of the second part.
+// Local literals never appear, so only the shared literals count, and only in McMillan's (first part)
+// or the dual (second part) system.
+abc::Aig_Obj_t* Interpolator::get_clause_aig_node(abc::Aig_Man_t* man, std::span<const int> clause, bool first_part) {
+  if (first_part && interpolation_system != InterpolationSystem::MCMILLAN) {
+    return abc::Aig_ManConst0(man);
+  } else if (!first_part && interpolation_system != InterpolationSystem::DUAL_MCMILLAN) {
+    return abc::Aig_ManConst1(man);
+  }
+  aig_operands.clear();
+  for (auto l: clause) {
+    aig_operands.push_back(get_literal_aig_node(man, l));
+  }
+  return abc::Aig_NotCond(balance_aig_nodes(man, aig_operands, false), !first_part);
+}
+
+void Interpolator::prepare_direct_aig(const std::vector<int>& shared_variables, InterpolationSystem system) {
+  // Cached interpolants depend on the shared variables and the system, so start over when they change.
+  // This includes added shared variables: a variable that was local when a clause was cached had its
+  // literals dropped and its pivots resolved as local, which is not sound once it is shared.
+  std::unordered_set<int> new_shared_variables_set(shared_variables.begin(), shared_variables.end());
+  if (replay_aig_man && new_shared_variables_set == shared_variables_set && system == interpolation_system) {
+    return;
+  }
+  reset_proof_cache();
+  interpolation_system = system;
+  set_shared_variables(shared_variables);
+  replay_aig_man = abc::Aig_ManStart(shared_variables.size());
+}
+
+abc::Aig_Obj_t* Interpolator::get_aig_node(uint64_t id) {
+  auto cached_literal = clause_id_to_aig_literal.get(id);
+  if (cached_literal != ClauseIdTable::EMPTY) {
+    return aig_node_from_literal(replay_aig_man, cached_literal);
+  }
+  // If there is no AIG node for this id, it has to be an original clause.
+  assert(solver.is_initial_clause(id));
+  abc::Aig_Obj_t* clause_output;
+  clause_output = get_clause_aig_node(replay_aig_man, solver.get_clause(id), id_in_first_part.get(id));
+  clause_id_to_aig_literal.set(id, aig_literal(clause_output));
+  return clause_output;
+}
+
+abc::Aig_Obj_t* Interpolator::build_aig_node(uint64_t conflict_id, std::span<const ResolutionStep> steps) {
+  auto start = get_aig_node(conflict_id);
+  chain_pivots.clear();
+  chain_aig_nodes.clear();
+  for (const auto& step: steps) {
+    chain_pivots.push_back(step.pivot);
+    chain_aig_nodes.push_back(get_aig_node(step.antecedent));
   }
-  // Add clauses from Tseitin conversion.
-  if (pConst1) { // Constant 1 if necessary.
-    interpolant_clauses.push_back( { pConst1->iData } );
+  return resolve_chain(replay_aig_man, start, chain_pivots, chain_aig_nodes);
+}
+
+// Copy the cones of the given (regular) nodes of the replay AIG into a fresh manager, keeping the order of the CIs.
+// Afterwards, pData of every copied node of the replay AIG points to its copy.
+abc::Aig_Man_t* Interpolator::copy_replay_aig_cones(std::vector<abc::Aig_Obj_t*>& roots) {
+  auto man = abc::Aig_ManStart(abc::Aig_ManNodeNum(replay_aig_man));
+  abc::Aig_Obj_t * pObj;
+  int i;
+  abc::Aig_ManConst1(replay_aig_man)->pData = abc::Aig_ManConst1(man);
+  Aig_ManForEachCi( replay_aig_man, pObj, i ) {
+    pObj->pData = abc::Aig_ObjCreateCi(man);
   }
+  auto vNodes = abc::Aig_ManDfsNodes(replay_aig_man, roots.data(), static_cast<int>(roots.size()));
   Vec_PtrForEachEntry( abc::Aig_Obj_t *, vNodes, pObj, i ) {
-    auto variable_output = pObj->iData;
-    auto variable_input0 = abc::Aig_ObjFanin0(pObj)->iData;
-    auto variable_input1 = abc::Aig_ObjFanin1(pObj)->iData;
-    auto literal_input0 = Aig_ObjFaninC0(pObj) ? -variable_input0 : variable_input0;
-    auto literal_input1 = Aig_ObjFaninC1(pObj) ? -variable_input1 : variable_input1;
-    interpolant_clauses.push_back( { literal_input0, -variable_output } );
-    interpolant_clauses.push_back( { literal_input1, -variable_output } );
-    interpolant_clauses.push_back( { -literal_input0, -literal_input1, variable_output } );
-  }
-  // Write clauses for PO.
-  Aig_ManForEachCo( aig_man, pObj, i ) {
-    auto variable_output = pObj->iData;
-    auto variable_input0 = abc::Aig_ObjFanin0(pObj)->iData;
-    auto literal_input0 = Aig_ObjFaninC0(pObj) ? -variable_input0 : variable_input0;
-    interpolant_clauses.push_back( { literal_input0, -variable_output } );
-    interpolant_clauses.push_back( { -literal_input0, variable_output } );
+    pObj->pData = abc::Aig_And(man, abc::Aig_ObjChild0Copy(pObj), abc::Aig_ObjChild1Copy(pObj));
   }
   abc::Vec_PtrFree( vNodes );
+  return man;
+}
+
+void Interpolator::extract_aig(abc::Aig_Obj_t* rootnode) {
+  std::vector<abc::Aig_Obj_t*> roots = {abc::Aig_Regular(rootnode)};
+  aig_man = copy_replay_aig_cones(roots);
+  abc::Aig_ObjCreateCo(aig_man, abc::Aig_NotCond(static_cast<abc::Aig_Obj_t*>(roots.front()->pData), abc::Aig_IsComplement(rootnode)));
+}
+
+void Interpolator::compact_replay_aig() {
+  std::vector<abc::Aig_Obj_t*> roots;
+  roots.reserve(clause_id_to_aig_literal.size());
+  clause_id_to_aig_literal.for_each_value([this, &roots](uint32_t literal) {
+    roots.push_back(abc::Aig_Regular(aig_node_from_literal(replay_aig_man, literal)));
+  });
+  auto compacted_man = copy_replay_aig_cones(roots);
+  clause_id_to_aig_literal.transform_values([this](uint32_t literal) {
+    auto node = aig_node_from_literal(replay_aig_man, literal);
+    return aig_literal(abc::Aig_NotCond(static_cast<abc::Aig_Obj_t*>(abc::Aig_Regular(node)->pData), abc::Aig_IsComplement(node)));
+  });
+  for (auto& [variable, ci]: variable_to_ci) {
+    ci = static_cast<abc::Aig_Obj_t*>(ci->pData);
+  }
+  gc_statistics.reclaimed_aig_nodes += abc::Aig_ManNodeNum(replay_aig_man) - abc::Aig_ManNodeNum(compacted_man);
+  abc::Aig_ManStop(replay_aig_man);
+  replay_aig_man = compacted_man;
+}
+
+std::pair<int, std::vector<std::vector<int>>> Interpolator::get_interpolant_clauses(int auxiliary_variable_start, bool rewrite_aig) {
+  Aig_ManCleanup(aig_man);
+  if (abc::Aig_ManNodeNum(aig_man) > 0 && rewrite_aig) {
+    aig_man = optimize_aig(aig_man, aig_optimization, aig_optimization_statistics);
+  }
+  assert(abc::Aig_ManCoNum(aig_man) == 1);
+  std::vector<std::vector<int>> interpolant_clauses;
+  auto output_variable = auxiliary_variable_start;
+  if (shared_aig) {
+    output_variable = add_to_shared_aig(auxiliary_variable_start, interpolant_clauses);
+  } else {
+    interpolant_clauses = encode_aig(aig_man, aig_input_variables, auxiliary_variable_start, cnf_encoding, cnf_encoding_statistics);
+  }
   abc::Aig_ManStop(aig_man);
-  return interpolant_clauses;
+  return std::make_pair(output_variable, std::move(interpolant_clauses));
+}
+
+void Interpolator::set_shared_aig(bool shared_aig) {
+  if (!shared_aig) {
+    reset_shared_aig();
+  }
+  this->shared_aig = shared_aig;
 }
 
-void Interpolator::process_node(const std::shared_ptr<Proofnode>& proofnode) {
+void Interpolator::reset_shared_aig() {
+  if (shared_aig_man) {
+    abc::Aig_ManStop(shared_aig_man);
+    shared_aig_man = nullptr;
+  }
+  shared_aig_inputs.clear();
+  shared_aig_encoder.reset();
+}
+
+// Copy the interpolant AIG into the shared AIG, where structural hashing merges it with the logic of
+// previous interpolants, and encode the nodes that are new.
+int Interpolator::add_to_shared_aig(int auxiliary_variable_start, std::vector<std::vector<int>>& clauses) {
+  if (shared_aig_man && auxiliary_variable_start > shared_aig_variable_start) {
+    // Variables of the shared AIG may collide with the new input variables.
+    auxiliary_variable_start = std::max(auxiliary_variable_start, shared_aig_encoder->get_next_variable());
+    reset_shared_aig();
+  }
+  if (!shared_aig_man) {
+    shared_aig_man = abc::Aig_ManStart(abc::Aig_ManNodeNum(aig_man));
+    shared_aig_encoder = std::make_unique<IncrementalCnfEncoder>(auxiliary_variable_start);
+    shared_aig_variable_start = auxiliary_variable_start;
+  }
+  abc::Aig_Obj_t* pObj;
+  int i;
+  abc::Aig_ManConst1(aig_man)->pData = abc::Aig_ManConst1(shared_aig_man);
+  Aig_ManForEachCi( aig_man, pObj, i ) {
+    auto variable = aig_input_variables[i];
+    auto [input, inserted] = shared_aig_inputs.emplace(variable, nullptr);
+    if (inserted) {
+      input->second = abc::Aig_ObjCreateCi(shared_aig_man);
+      shared_aig_encoder->set_input_variable(input->second, variable);
+    }
+    pObj->pData = input->second;
+  }
+  auto nodes = abc::Aig_ManDfs(aig_man, 1);
+  Vec_PtrForEachEntry( abc::Aig_Obj_t *, nodes, pObj, i ) {
+    pObj->pData = abc::Aig_And(shared_aig_man, abc::Aig_ObjChild0Copy(pObj), abc::Aig_ObjChild1Copy(pObj));
+  }
+  abc::Vec_PtrFree(nodes);
+  auto driver = abc::Aig_ObjChild0Copy(abc::Aig_ManCo(aig_man, 0));
+  abc::Aig_ObjCreateCo(shared_aig_man, driver);
+  cnf_encoding_statistics.aig_nodes += abc::Aig_ManNodeNum(aig_man);
+  return shared_aig_encoder->encode_output(shared_aig_man, driver, cnf_encoding, clauses, cnf_encoding_statistics);
+}
+
+abc::Aig_Obj_t* Interpolator::get_processed_node(ProofnodeIndex index) const {
+  const auto& entry = proofnode_to_aig_node[index];
+  return entry.epoch == aig_epoch ? entry.node : nullptr;
+}
+
+void Interpolator::process_node(ProofnodeIndex index) {
   // The node must not have been processed.
-  assert(!proofnode_to_aig_node.contains(proofnode));
-  if (proofnode->left == nullptr && proofnode->right == nullptr) {
-    // Leaf node: constant or CI.
-    if (proofnode->label) {
-      auto variable = abs(proofnode->label);
-      if (shared_variables_set.contains(variable)) {
-        // If the variable is shared and no CI has been created, create a CI node.
-        if (!variable_to_ci.contains(variable)) {
-          aig_input_variables.push_back(variable);
-          variable_to_ci[variable] = abc::Aig_ObjCreateCi(aig_man);
-        }
-        auto variable_node = variable_to_ci.at(variable);
-        // Negate variable if necessary.
-        auto aig_node = abc::Aig_NotCond(variable_node, proofnode->label < 0);
-        proofnode_to_aig_node[proofnode] = aig_node;
-      } else {
-        proofnode_to_aig_node[proofnode] = abc::Aig_ManConst0(aig_man);
+  assert(get_processed_node(index) == nullptr);
+  const auto& proofnode = proofnodes[index];
+  abc::Aig_Obj_t* aig_node = nullptr;
+  switch (proofnode.type) {
+    case ProofnodeType::CLAUSE:
+    case ProofnodeType::SECOND_PART_CLAUSE:
+      aig_node = get_clause_aig_node(aig_man, proofnodes.get_literals(proofnode), proofnode.type == ProofnodeType::CLAUSE);
+      break;
+    case ProofnodeType::CHAIN: {
+      chain_pivots.clear();
+      chain_aig_nodes.clear();
+      for (uint32_t step = 0; step < proofnode.size; step++) {
+        chain_pivots.push_back(proofnodes.get_pivot(proofnode, step));
+        chain_aig_nodes.push_back(get_processed_node(proofnodes.get_antecedent(proofnode, step)));
+        assert(chain_aig_nodes.back() != nullptr);
       }
-    } else { // Label 0 means constant 1.
-      proofnode_to_aig_node[proofnode] = abc::Aig_ManConst1(aig_man);
-    }
-  } else if (proofnode->left == nullptr) {
-    // Copy the object obtained from the right node.
-    assert(proofnode_to_aig_node.contains(proofnode->right));
-    proofnode_to_aig_node[proofnode] = proofnode_to_aig_node.at(proofnode->right);
-  } else if (proofnode->right == nullptr) {
-    // This ought not to occur.
-    assert(false);
-  } else {
-    // Both left and right nodes are present.
-    auto left_node = proofnode_to_aig_node.at(proofnode->left);
-    auto right_node = proofnode_to_aig_node.at(proofnode->right);
-    if (proofnode->label && (shared_variables_set.contains(proofnode->label) || (!first_part_variables_set.contains(proofnode->label)))) {
-      // If the variables NOT local to the first part, create an AND node.
-      proofnode_to_aig_node[proofnode] = abc::Aig_And(aig_man, left_node, right_node);
-    } else {
-      // Otherwise, create an OR node.
-      proofnode_to_aig_node[proofnode] = abc::Aig_Or(aig_man, left_node, right_node);
+      auto start = get_processed_node(proofnodes.get_chain_start(proofnode));
+      assert(start != nullptr);
+      aig_node = resolve_chain(aig_man, start, chain_pivots, chain_aig_nodes);
+      break;
     }
   }
-  // std::cout << "Label: " << proofnode->label << std::endl;
-  // abc::Aig_ObjPrint(aig_man, proofnode_to_aig_node.at(proofnode));
-  // std::cout << std::endl;
+  proofnode_to_aig_node[index] = StampedAigNode{aig_node, aig_epoch};
 }
 
-void Interpolator::construct_aig(std::shared_ptr<Proofnode>& rootnode, const std::vector<int>& shared_variables) {
+void Interpolator::construct_aig(ProofnodeIndex rootnode, const std::vector<int>& shared_variables) {
   // Reset AIG-related data structures.
-  proofnode_to_aig_node.clear();
-  variable_to_ci.clear();
-  aig_input_variables.clear();
-  shared_variables_set.clear();
-  shared_variables_set.insert(shared_variables.begin(), shared_variables.end());
+  // A new epoch marks all nodes as not processed; only the nodes created since the last call get new entries.
+  if (++aig_epoch == 0) {
+    std::fill(proofnode_to_aig_node.begin(), proofnode_to_aig_node.end(), StampedAigNode{nullptr, 0});
+    aig_epoch = 1;
+  }
+  if (proofnode_to_aig_node.size() < proofnodes.size()) {
+    proofnode_to_aig_node.resize(proofnodes.size(), StampedAigNode{nullptr, 0});
+  }
+  set_shared_variables(shared_variables);
+  // Create an AIG manager.
+  aig_man = abc::Aig_ManStart(shared_variables.size());
 
-  assert(rootnode != nullptr);
+  assert(rootnode != NO_PROOFNODE);
 
-  std::vector<std::shared_ptr<Proofnode>> stack;
-  std::vector<std::shared_ptr<Proofnode>> processed_nodes;
+  std::vector<ProofnodeIndex> stack;
   stack.push_back(rootnode);
 
   while (!stack.empty()) {
-    auto node = stack.back();
-    stack.pop_back();
+    auto index = stack.back();
 
-    if (node->flag) {
+    if (get_processed_node(index) != nullptr) {
       // If the node has already been processed, skip it.
+      stack.pop_back();
       continue;
     }
 
-    if ((node->left && !node->left->flag) || (node->right && !node->right->flag)) {
-      // If any of the child nodes are not processed, push this node back into the stack.
-      stack.push_back(node);
-      // Push unprocessed child nodes into the stack.
-      if (node->right && !node->right->flag) {
-        stack.push_back(node->right);
+    const auto& node = proofnodes[index];
+    bool children_pending = false;
+    if (node.type == ProofnodeType::CHAIN) {
+      // If any of the child nodes are not processed, keep this node on the stack
+      // and push the unprocessed child nodes on top of it.
+      for (uint32_t step = node.size; step-- > 0;) {
+        auto antecedent = proofnodes.get_antecedent(node, step);
+        if (get_processed_node(antecedent) == nullptr) {
+          stack.push_back(antecedent);
+          children_pending = true;
+        }
       }
-      if (node->left && !node->left->flag) {
-        stack.push_back(node->left);
+      auto start = proofnodes.get_chain_start(node);
+      if (get_processed_node(start) == nullptr) {
+        stack.push_back(start);
+        children_pending = true;
       }
-    } else {
-      // If both child nodes are processed (or don't exist), we can process this node.
-      process_node(node);
-      processed_nodes.push_back(node);
-      node->flag = true;
     }
-  }
-  // Reset flags.
-  for (auto node : processed_nodes) {
-    node->flag = false;
+    if (!children_pending) {
+      // If all child nodes are processed (or don't exist), we can process this node.
+      stack.pop_back();
+      process_node(index);
+    }
   }
   // Create PO.
-  abc::Aig_ObjCreateCo(aig_man, proofnode_to_aig_node.at(rootnode) );
+  abc::Aig_ObjCreateCo(aig_man, get_processed_node(rootnode));
 }
 
-std::pair<int, std::vector<std::vector<int>>> Interpolator::get_interpolant(const std::vector<int>& shared_variables, int auxiliary_variable_start, bool rewrite_aig) {
+// Build the interpolant in each system from the same Proofnodes and keep the smallest AIG.
+void Interpolator::construct_smallest_aig(ProofnodeIndex rootnode, const std::vector<int>& shared_variables) {
+  abc::Aig_Man_t* smallest_aig_man = nullptr;
+  std::vector<int> smallest_input_variables;
+  for (auto system: {InterpolationSystem::MCMILLAN, InterpolationSystem::PUDLAK, InterpolationSystem::DUAL_MCMILLAN}) {
+    interpolation_system = system;
+    construct_aig(rootnode, shared_variables);
+    abc::Aig_ManCleanup(aig_man);
+    if (smallest_aig_man == nullptr || abc::Aig_ManNodeNum(aig_man) < abc::Aig_ManNodeNum(smallest_aig_man)) {
+      if (smallest_aig_man) {
+        abc::Aig_ManStop(smallest_aig_man);
+      }
+      smallest_aig_man = aig_man;
+      // The CIs of each AIG are created on first use, so their order differs between the systems.
+      smallest_input_variables.swap(aig_input_variables);
+    } else {
+      abc::Aig_ManStop(aig_man);
+    }
+  }
+  aig_man = smallest_aig_man;
+  aig_input_variables.swap(smallest_input_variables);
+}
+
+std::pair<int, std::vector<std::vector<int>>> Interpolator::get_interpolant(const std::vector<int>& shared_variables, int auxiliary_variable_start, bool rewrite_aig,
+                                                                            InterpolationSystem system) {
   if (state != State::UNSAT) {
     throw InterpolatorStateException("can only call get_interpolant in UNSAT state");
   }
   delete_clauses();
   state = State::UNDEFINED;
   solver.get_failed(last_assumptions); // Needed to generate final part of LRAT proof.
+  if (direct_aig) {
+    prepare_direct_aig(shared_variables, system == InterpolationSystem::AUTO ? InterpolationSystem::MCMILLAN : system);
+  }
   auto core = get_core();
   if (core.empty()) {
     // If the core is empty, the formula is unsatisfiable. In this case, we return a trivial interpolant.
-    return std::make_pair(auxiliary_variable_start, std::vector<std::vector<int>>{{-auxiliary_variable_start}});
+    if (!shared_aig) {
+      return std::make_pair(auxiliary_variable_start, std::vector<std::vector<int>>{{-auxiliary_variable_start}});
+    }
+    // Its output is numbered by the shared AIG like all others.
+    aig_man = abc::Aig_ManStart(0);
+    aig_input_variables.clear();
+    abc::Aig_ObjCreateCo(aig_man, abc::Aig_ManConst0(aig_man));
+    return get_interpolant_clauses(auxiliary_variable_start, false);
   }
   replay_proof(core);
-  auto interpolant_clauses = get_interpolant_clauses(clause_id_to_proofnode.at(core.back()), shared_variables, auxiliary_variable_start, rewrite_aig);
-  return std::make_pair(auxiliary_variable_start, interpolant_clauses);
+  if (direct_aig) {
+    extract_aig(aig_node_from_literal(replay_aig_man, clause_id_to_aig_literal.get(core.back())));
+  } else {
+    // The compressed proof is only needed for this interpolant, the cached Proofnodes stay as they are.
+    ProofnodeTruncation truncation(proofnodes);
+    auto rootnode = clause_id_to_proofnode.get(core.back());
+    if (proof_compression_seconds > 0) {
+      rootnode = compress_proof(proofnodes, rootnode, proof_compression_seconds, proof_compression_statistics);
+    }
+    if (system == InterpolationSystem::AUTO) {
+      construct_smallest_aig(rootnode, shared_variables);
+    } else {
+      interpolation_system = system;
+      construct_aig(rootnode, shared_variables);
+    }
+  }
+  return get_interpolant_clauses(auxiliary_variable_start, rewrite_aig);
 }
 
 }
\ No newline at end of file
@@ -2,27 +2,44 @@
 #define ITP_INTERPOLATOR_H_
 
 #include <vector>
+#include <span>
 #include <tuple>
 #include <unordered_set>
 #include <unordered_map>
 #include <fstream>
-#include <memory>
 #include <string>
+#include <memory>
+#include <chrono>
 
 #include "aig/aig/aig.h"
 
 #include "cadical_solver.hpp"
+#include "proofnode.hpp"
+#include "id_table.hpp"
+#include "aig_optimizer.hpp"
+#include "proof_compression.hpp"
+#include "cnf_encoder.hpp"
 
 namespace cadical_itp {
 
-struct Proofnode {
-  int label;
-  bool flag;
-  std::shared_ptr<Proofnode> left;
-  std::shared_ptr<Proofnode> right;
-  // Constructors
-  Proofnode(int label, const std::shared_ptr<Proofnode>& left, const std::shared_ptr<Proofnode>& right) : label(label), flag(false), left(left), right(right) {}
-  Proofnode(int label) : label(label), flag(false), left(nullptr), right(nullptr) {}
+// Statistics of the garbage collector for the Proofnodes and replay AIG cached by the interpolator.
+// The clause and premise store of the solver is not collected and not counted in the bytes.
+struct ProofCacheGCStatistics {
+  uint64_t collections = 0;
+  uint64_t reclaimed_proofnodes = 0;
+  uint64_t reclaimed_aig_nodes = 0;
+  // Bytes in use after the last collection, and the maximum observed before any collection.
+  std::size_t live_bytes = 0;
+  std::size_t peak_bytes = 0;
+  double seconds = 0;
+};
+
+// Labeled interpolation systems, which differ in the label of shared literals.
+enum class InterpolationSystem {
+  MCMILLAN,      // Shared literals are labeled b: the strongest interpolant.
+  PUDLAK,        // Symmetric system, shared literals are labeled ab.
+  DUAL_MCMILLAN, // Shared literals are labeled a: the weakest interpolant.
+  AUTO           // Build all of the above from the same replayed proof and keep the smallest AIG.
 };
 
 class Interpolator {
@@ -30,11 +47,61 @@ class Interpolator {
   Interpolator();
   ~Interpolator();
   void add_clause(const std::vector<int>& clause, bool first_part);
+  void add_clause(std::span<const int> clause, bool first_part);
   void append_formula(const std::vector<std::vector<int>>& formula, bool first_part);
+  void append_formula(const ClauseArena& formula, bool first_part);
+  void append_formula(std::span<const int> literals, std::span<const std::size_t> offsets, bool first_part);
   bool solve(const std::vector<int>& assumptions);
+  // Solve within the given budget (and deadline). Returns UNKNOWN if either is exhausted and throws
+  // InterruptedException if the cancellation token is cancelled. Either way the interpolator stays usable.
+  SolveResult solve(const std::vector<int>& assumptions, const SolveBudget& budget);
+  void set_cancellation_token(std::shared_ptr<CancellationToken> token) { solver.set_cancellation_token(std::move(token)); }
+  void set_deadline(std::chrono::steady_clock::time_point deadline) { solver.set_deadline(deadline); }
+  void clear_deadline() { solver.clear_deadline(); }
   std::vector<int> get_model();
   std::vector<int> get_values(const std::vector<int>& variables);
-  std::pair<int, std::vector<std::vector<int>>> get_interpolant(const std::vector<int>& shared_variables, int auxiliary_variable_start, bool rewrite_aig);
+  // Assumptions of the last solve call that were needed for unsatisfiability.
+  std::vector<int> get_failed();
+  // In direct AIG mode, AUTO uses McMillan's system, as the cached interpolants belong to a single system.
+  std::pair<int, std::vector<std::vector<int>>> get_interpolant(const std::vector<int>& shared_variables, int auxiliary_variable_start, bool rewrite_aig,
+                                                                InterpolationSystem system = InterpolationSystem::MCMILLAN);
+  void reset_proof_cache();
+  // Build the interpolant AIG while replaying the proof, instead of going through Proofnodes.
+  // The cached interpolants of derived clauses are only valid for the shared variables and system
+  // they were built for, and are dropped whenever either changes, including when shared variables
+  // are added. Direct mode therefore only pays off for a fixed shared set, not for a growing prefix.
+  void set_direct_aig(bool direct_aig);
+  // Number of threads used to replay large proofs (0 means one per hardware thread).
+  void set_replay_threads(unsigned nr_threads);
+  // Trust the proof during replay: treat the first unassigned literal of a premise as implied
+  // instead of checking that the premise is unit or falsified.
+  void set_trusted_replay(bool trusted_replay);
+  // Collect the cached Proofnodes and replay AIG nodes that are no longer reachable from live clauses
+  // once they take more than the given number of bytes. Independently, Proofnodes are collected
+  // whenever their number has doubled since the last collection. Only these caches are measured and
+  // reclaimed: the solver keeps the clauses and premises of all ids, which get_clause and get_premises
+  // read, as it has no call to release them.
+  void set_gc_watermark(std::size_t bytes);
+  void collect_garbage();
+  std::size_t get_proof_cache_memory_usage() const;
+  const ProofCacheGCStatistics& get_gc_statistics() const { return gc_statistics; }
+  // Optimization of the interpolant AIG, run by get_interpolant if rewrite_aig is set.
+  void set_aig_optimization(const AigOptimizationConfig& config) { aig_optimization = config; }
+  const AigOptimizationStatistics& get_aig_optimization_statistics() const { return aig_optimization_statistics; }
+  // Compress the replayed proof for at most the given number of seconds before building the
+  // interpolant (0 disables compression). Not used in direct AIG mode, which builds no Proofnodes.
+  void set_proof_compression(double seconds) { proof_compression_seconds = seconds; }
+  const ProofCompressionStatistics& get_proof_compression_statistics() const { return proof_compression_statistics; }
+  // Encoding of the interpolant clauses returned by get_interpolant.
+  void set_cnf_encoding(const CnfEncodingConfig& config) { cnf_encoding = config; }
+  const CnfEncodingStatistics& get_cnf_encoding_statistics() const { return cnf_encoding_statistics; }
+  // Add all interpolants to one structurally hashed AIG and only return the clauses of nodes that
+  // previous interpolants did not use, so the returned clauses build on those of earlier calls.
+  // Auxiliary variables are numbered on from the first call; a call with a larger
+  // auxiliary_variable_start starts a new AIG above all variables used so far.
+  void set_shared_aig(bool shared_aig);
+  // Number of AND nodes in the shared AIG.
+  int get_shared_aig_size() const { return shared_aig_man ? abc::Aig_ManNodeNum(shared_aig_man) : 0; }
 
   // Exception class to throw when interpolator is not in the correct state.
   class InterpolatorStateException : public std::exception {
@@ -57,54 +124,188 @@ class Interpolator {
 
   State state;
 
+  // One step of a resolution chain: resolve on pivot with the antecedent clause, which contains the pivot literal.
+  struct ResolutionStep {
+    int pivot;
+    uint64_t antecedent;
+  };
+
+  // Replay state of a variable, kept in one record so that each literal touch is a single access.
+  struct VariableState {
+    uint64_t reason;
+    bool assigned;
+    bool seen;
+  };
+
+  // Scratch state for replaying a single derived clause.
+  struct ReplayContext {
+    std::vector<VariableState> variables;
+    std::vector<int> trail;
+    void resize(std::size_t nr_variables) { variables.resize(nr_variables, VariableState{0, false, false}); }
+  };
+
+  // Operator combining the partial interpolants of a resolution step.
+  enum class ResolutionOperator {
+    AND,
+    OR,
+    MUX
+  };
+
+  // Location of a replayed chain in the step buffer of the thread that analyzed it.
+  struct ReplayedChain {
+    uint64_t conflict_id;
+    unsigned thread;
+    std::size_t begin;
+    std::size_t size;
+  };
+
   std::vector<int> get_clause(uint64_t id) const;
-  std::vector<uint64_t> get_core() const;
+  std::vector<uint64_t> get_core();
+  bool has_interpolant(uint64_t id) const;
   void replay_proof(std::vector<uint64_t>& core);
-  uint64_t propagate(uint64_t id);
-  std::pair<std::vector<int>, std::shared_ptr<Proofnode>> analyze_and_interpolate(uint64_t id);
+  void replay_proof_parallel(const std::vector<uint64_t>& core, unsigned nr_threads);
+  void add_replayed_clause(uint64_t id, uint64_t conflict_id, std::span<const ResolutionStep> steps);
+  uint64_t propagate(ReplayContext& context, uint64_t id) const;
+  std::vector<int> analyze(ReplayContext& context, uint64_t id, std::vector<ResolutionStep>& steps) const;
   void delete_clauses();
-  std::vector<std::vector<int>> get_interpolant_clauses(std::shared_ptr<Proofnode>& rootnode, const std::vector<int>& shared_variables, int auxiliary_variable_start, bool rewrite_aig);
-  std::shared_ptr<Proofnode> get_proofnode(uint64_t id);
-  void construct_aig(std::shared_ptr<Proofnode>& rootnode, const std::vector<int>& shared_variables);
-  void process_node(const std::shared_ptr<Proofnode>& proofnode);
-
-  std::vector<uint64_t> reason;
-  std::vector<bool> is_assigned;
-  std::vector<bool> variable_seen;
-  std::unordered_map<uint64_t, bool> id_in_first_part;
+  std::pair<int, std::vector<std::vector<int>>> get_interpolant_clauses(int auxiliary_variable_start, bool rewrite_aig);
+  int add_to_shared_aig(int auxiliary_variable_start, std::vector<std::vector<int>>& clauses);
+  void reset_shared_aig();
+  ProofnodeIndex get_proofnode(uint64_t id);
+  ProofnodeIndex build_proofnode(uint64_t conflict_id, std::span<const ResolutionStep> steps);
+  void construct_aig(ProofnodeIndex rootnode, const std::vector<int>& shared_variables);
+  void construct_smallest_aig(ProofnodeIndex rootnode, const std::vector<int>& shared_variables);
+  void process_node(ProofnodeIndex index);
+  abc::Aig_Obj_t* get_processed_node(ProofnodeIndex index) const;
+  void set_shared_variables(const std::vector<int>& shared_variables);
+  abc::Aig_Obj_t* get_literal_aig_node(abc::Aig_Man_t* man, int literal);
+  ResolutionOperator get_resolution_operator(int pivot) const;
+  abc::Aig_Obj_t* balance_aig_nodes(abc::Aig_Man_t* man, std::vector<abc::Aig_Obj_t*>& operands, bool conjunction);
+  abc::Aig_Obj_t* resolve_chain(abc::Aig_Man_t* man, abc::Aig_Obj_t* start, std::span<const int> pivots, std::span<abc::Aig_Obj_t* const> antecedents);
+  abc::Aig_Obj_t* get_clause_aig_node(abc::Aig_Man_t* man, std::span<const int> clause, bool first_part);
+  void prepare_direct_aig(const std::vector<int>& shared_variables, InterpolationSystem system);
+  abc::Aig_Obj_t* get_aig_node(uint64_t id);
+  abc::Aig_Obj_t* build_aig_node(uint64_t conflict_id, std::span<const ResolutionStep> steps);
+  void extract_aig(abc::Aig_Obj_t* rootnode);
+  abc::Aig_Man_t* copy_replay_aig_cones(std::vector<abc::Aig_Obj_t*>& roots);
+  void compact_replay_aig();
+
+  ReplayContext replay_context;
+  unsigned replay_threads;
+  bool trusted_replay;
+  IdBitmap id_in_first_part;
   std::unordered_set<int> first_part_variables_set;
   std::vector<int> last_assumptions;
-  std::vector<int> trail;
+  std::vector<ResolutionStep> resolution_steps;
+  std::vector<int> chain_pivots;
+  std::vector<ProofnodeIndex> chain_antecedents;
+  std::vector<abc::Aig_Obj_t*> chain_aig_nodes;
+  std::vector<abc::Aig_Obj_t*> aig_operands;
   std::vector<uint64_t> to_delete;
   Cadical solver;
 
-  std::unordered_map<uint64_t, std::shared_ptr<Proofnode>> clause_id_to_proofnode;
+  ProofnodeArena proofnodes;
+  ClauseIdTable clause_id_to_proofnode;
 
-  std::unordered_map<std::shared_ptr<Proofnode>,abc::Aig_Obj_t*> proofnode_to_aig_node;
+  // Interpolants of the Proofnodes processed by the current construct_aig call: entries stamped
+  // with an older epoch are stale, so the table is not reset per interpolant.
+  struct StampedAigNode {
+    abc::Aig_Obj_t* node;
+    uint32_t epoch;
+  };
+  std::vector<StampedAigNode> proofnode_to_aig_node;
+  uint32_t aig_epoch;
+  // Arena size that triggers reclaiming the Proofnodes of deleted clauses.
+  std::size_t proofnode_reclaim_threshold;
   std::unordered_map<int, abc::Aig_Obj_t*> variable_to_ci;
   std::unordered_set<int> shared_variables_set;
   std::vector<int> aig_input_variables;
   abc::Aig_Man_t * aig_man;
+  // System of the interpolant under construction (never AUTO).
+  InterpolationSystem interpolation_system;
+
+  // Direct mode: interpolants of derived clauses as literals of a persistent AIG over shared_variables_set.
+  bool direct_aig;
+  abc::Aig_Man_t * replay_aig_man;
+  ClauseIdTable clause_id_to_aig_literal;
+
+  std::size_t gc_watermark;
+  std::size_t gc_threshold;
+  ProofCacheGCStatistics gc_statistics;
+  AigOptimizationConfig aig_optimization;
+  AigOptimizationStatistics aig_optimization_statistics;
+  double proof_compression_seconds;
+  ProofCompressionStatistics proof_compression_statistics;
+  CnfEncodingConfig cnf_encoding;
+  CnfEncodingStatistics cnf_encoding_statistics;
+
+  // Persistent AIG with one CO per interpolant, over CIs for the variables in shared_aig_inputs.
+  bool shared_aig;
+  abc::Aig_Man_t * shared_aig_man;
+  std::unordered_map<int, abc::Aig_Obj_t*> shared_aig_inputs;
+  std::unique_ptr<IncrementalCnfEncoder> shared_aig_encoder;
+  int shared_aig_variable_start;
 };
 
+inline void Interpolator::add_clause(const std::vector<int>& clause, bool first_part) {
+  add_clause(std::span<const int>(clause), first_part);
+}
+
 inline void Interpolator::append_formula(const std::vector<std::vector<int>>& formula, bool first_part) {
-  id_in_first_part.reserve(id_in_first_part.size() + formula.size());
+  id_in_first_part.reserve(solver.get_current_clause_id() + formula.size() + 1);
   for (const auto& clause: formula) {
     add_clause(clause, first_part);
   }
 }
 
+inline void Interpolator::append_formula(const ClauseArena& formula, bool first_part) {
+  append_formula(formula.get_literals(), formula.get_offsets(), first_part);
+}
+
+inline void Interpolator::append_formula(std::span<const int> literals, std::span<const std::size_t> offsets, bool first_part) {
+  if (offsets.empty()) {
+    return;
+  }
+  id_in_first_part.reserve(solver.get_current_clause_id() + offsets.size());
+  for (std::size_t i = 0; i + 1 < offsets.size(); i++) {
+    add_clause(literals.subspan(offsets[i], offsets[i + 1] - offsets[i]), first_part);
+  }
+}
+
 inline bool Interpolator::solve(const std::vector<int>& assumptions) {
+  auto result = solve(assumptions, SolveBudget{});
+  if (result == SolveResult::UNKNOWN) {
+    throw InterpolatorStateException("solver stopped at the deadline");
+  }
+  return result == SolveResult::SAT;
+}
+
+inline SolveResult Interpolator::solve(const std::vector<int>& assumptions, const SolveBudget& budget) {
+  state = State::UNDEFINED;
   last_assumptions = assumptions;
-  auto result = solver.solve(assumptions);
+  int result;
+  try {
+    result = solver.solve(assumptions, budget);
+  } catch (InterruptedException&) {
+    // Reclaim what the aborted search deleted; the instance remains usable.
+    delete_clauses();
+    throw;
+  }
+  SolveResult solve_result;
   if (result == 10) {
     state = State::SAT;
+    solve_result = SolveResult::SAT;
   } else if (result == 20) {
     state = State::UNSAT;
+    solve_result = SolveResult::UNSAT;
+  } else if (result == 0) {
+    solve_result = SolveResult::UNKNOWN;
   } else {
     throw InterpolatorStateException("unexpected result from solver");
   }
-  return result != 20;
+  // Drop cached data of clauses deleted during search, also when no interpolant is requested.
+  delete_clauses();
+  return solve_result;
 }
 
 inline std::vector<int> Interpolator::get_model() {
@@ -121,6 +322,13 @@ inline std::vector<int> Interpolator::get_values(const std::vector<int>& variabl
   return solver.get_values(variables);
 }
 
+inline std::vector<int> Interpolator::get_failed() {
+  if (state != State::UNSAT) {
+    throw InterpolatorStateException("can only call get_failed in UNSAT state");
+  }
+  return solver.get_failed(last_assumptions);
+}
+
 // For debugging.
 
 inline bool contains(std::vector<int> v1, std::vector<int> v2) {
@@ -2,18 +2,25 @@
 
 namespace cadical_itp {
 
-int InterruptHandler::signal_received = 0;
+std::atomic<int> InterruptHandler::signal_received = 0;
+CancellationToken InterruptHandler::global_cancellation_token;
 
 void InterruptHandler::interrupt(int signal) {
-  signal_received = signal;
+  signal_received.store(signal, std::memory_order_relaxed);
+  global_cancellation_token.cancel();
 }
 
 int InterruptHandler::interrupted(void*) {
-  return signal_received;
+  return signal_received.load(std::memory_order_relaxed);
 }
 
-const char* InterruptedException::what() {
+std::shared_ptr<CancellationToken> InterruptHandler::global_token() {
+  // The global token lives as long as the process, so the pointer does not own it.
+  return std::shared_ptr<CancellationToken>(std::shared_ptr<CancellationToken>(), &global_cancellation_token);
+}
+
+const char* InterruptedException::what() const noexcept {
   return "SAT call interrupted";
 }
 
-}
\ No newline at end of file
+}
@@ -3,22 +3,41 @@
 
 #include <iostream>
 #include <exception>
+#include <atomic>
+#include <memory>
 
 namespace cadical_itp {
 
-class InterruptedException: std::exception {
-  virtual const char* what();
+class InterruptedException: public std::exception {
+ public:
+  const char* what() const noexcept override;
+};
+
+// Cancellation flag shared between a solver and whoever may cancel it: another thread,
+// Python code or a signal handler. Cancelling is lock-free and sticky until reset.
+class CancellationToken {
+ public:
+  void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+  void reset() { cancelled.store(false, std::memory_order_relaxed); }
+  bool is_cancelled() const { return cancelled.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<bool> cancelled = false;
 };
 
 class InterruptHandler {
  public:
+  // Signal handler: records the signal and cancels the global token.
   static void interrupt(int signal);
   static int interrupted(void*);
+  // Token cancelled by interrupt(). Solvers only observe it if it is set as their cancellation token.
+  static std::shared_ptr<CancellationToken> global_token();
 
  private:
-  static int signal_received;
+  static std::atomic<int> signal_received;
+  static CancellationToken global_cancellation_token;
 };
 
 }
 
-#endif // CADICAL_INTERRUPT_H_
\ No newline at end of file
+#endif // CADICAL_INTERRUPT_H_
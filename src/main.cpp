@@ -4,6 +4,15 @@
 #include <vector>
 #include <string>
 #include <iomanip>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <memory>
+#include <span>
+#include <cassert>
 
 #include "aig/aig/aig.h"
 #include "base/abc/abc.h"
@@ -11,6 +20,8 @@
 
 #include "qdimacs.hpp"
 #include "definabilitychecker.hpp"
+#include "work_queue.hpp"
+#include "forked_workers.hpp"
 
 void displayProgress(double progress) {
   int barWidth = 70;
@@ -26,36 +37,380 @@ void displayProgress(double progress) {
   std::cout.flush();
 }
 
+// Factor by which the budget grows from one retry pass to the next.
+constexpr double BUDGET_GROWTH = 4;
+
+struct Options {
+  std::string filename;
+  bool trusted_replay = false;
+  unsigned replay_threads = 1;
+  std::size_t gc_watermark_mb = 0;
+  unsigned threads = 1;
+  unsigned processes = 1;
+  cadical_itp::SolveBudget budget;
+  unsigned retries = 2;
+  bool monotone = false;
+  std::size_t witnesses = 256;
+  bool gates = true;
+  bool slicing = false;
+  cadical_itp::AigOptimizationConfig aig_optimization;
+  bool optimize_definitions = false;
+  double proof_compression_seconds = 0;
+  cadical_itp::CnfEncodingConfig cnf_encoding;
+  bool shared_aig = false;
+  bool direct_aig = false;
+  cadical_itp::InterpolationSystem interpolation_system = cadical_itp::InterpolationSystem::MCMILLAN;
+};
+
+void printUsage(const char* program) {
+  std::cout << "Usage: " << program << " [options] <file.qdimacs>" << std::endl
+            << "  --trusted-replay      trust the proof when replaying it for interpolation" << std::endl
+            << "  --replay-threads <n>  number of threads for proof replay (0: all cores)" << std::endl
+            << "  --gc-watermark <MB>   collect cached proof nodes of deleted clauses above this size (0: when they double)," << std::endl
+            << "                        the clauses and premises kept by the solver are not collected" << std::endl
+            << "  --threads <n>         number of checkers working in parallel (0: all cores)" << std::endl
+            << "  --processes <n>       number of forked processes sharing one loaded checker (0: all cores, not with --threads)" << std::endl
+            << "  --conflict-budget <n> conflicts per variable before giving up (0: unlimited)" << std::endl
+            << "  --decision-budget <n> decisions per variable before giving up (0: unlimited)" << std::endl
+            << "  --time-budget <s>     seconds per variable before giving up (0: unlimited)" << std::endl
+            << "  --retries <n>         passes over unknown variables, each with a " << BUDGET_GROWTH << " times larger budget" << std::endl
+            << "  --witnesses <n>       models kept to rule out definability without solving (0: none)" << std::endl
+            << "  --slice               only use the clauses connected to the checked variable in the second copy" << std::endl
+            << "  --interpolation <s>   interpolation system: mcmillan, pudlak, dual-mcmillan or auto (smallest)" << std::endl
+            << "  --compress-proof <s>  seconds per definition for compressing its proof (0: no compression)" << std::endl
+            << "  --cnf-encoding <e>    encoding of definitions: tseitin, pg (Plaisted-Greenbaum) or lut" << std::endl
+            << "  --lut-size <k>        maximal inputs of the cones merged by --cnf-encoding lut (2 to 6)" << std::endl
+            << "  --shared-aig          build all definitions of a checker in one AIG and encode common logic once" << std::endl
+            << "  --direct-aig          build definitions during proof replay, reusing the interpolants of derived clauses" << std::endl
+            << "                        only while the defining variables stay the same (a growing prefix rebuilds them for every variable)" << std::endl
+            << "  --aig-script <steps>  optimize definitions with ABC steps, e.g. \"b;rw;rf;dc2;fraig\"" << std::endl
+            << "  --aig-passes <n>      repetitions of the optimization script while it still shrinks the AIG" << std::endl
+            << "  --aig-time-budget <s> seconds per definition after which no optimization step is started" << std::endl
+            << "  --no-gates            check Tseitin gate outputs with the solver instead of taking the gate as definition" << std::endl
+            << "  --monotone            assert the equalities of checked variables permanently (not with --threads)" << std::endl;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; i++) {
+    std::string argument(argv[i]);
+    if (argument == "--trusted-replay") {
+      options.trusted_replay = true;
+    } else if (argument == "--monotone") {
+      options.monotone = true;
+    } else if (argument == "--slice") {
+      options.slicing = true;
+    } else if (argument == "--interpolation" && i + 1 < argc) {
+      std::string system(argv[++i]);
+      if (system == "mcmillan") {
+        options.interpolation_system = cadical_itp::InterpolationSystem::MCMILLAN;
+      } else if (system == "pudlak") {
+        options.interpolation_system = cadical_itp::InterpolationSystem::PUDLAK;
+      } else if (system == "dual-mcmillan") {
+        options.interpolation_system = cadical_itp::InterpolationSystem::DUAL_MCMILLAN;
+      } else if (system == "auto") {
+        options.interpolation_system = cadical_itp::InterpolationSystem::AUTO;
+      } else {
+        return false;
+      }
+    } else if (argument == "--compress-proof" && i + 1 < argc) {
+      options.proof_compression_seconds = std::stod(argv[++i]);
+    } else if (argument == "--cnf-encoding" && i + 1 < argc) {
+      std::string encoding(argv[++i]);
+      if (encoding == "tseitin") {
+        options.cnf_encoding.encoding = cadical_itp::CnfEncoding::TSEITIN;
+      } else if (encoding == "pg") {
+        options.cnf_encoding.encoding = cadical_itp::CnfEncoding::PLAISTED_GREENBAUM;
+      } else if (encoding == "lut") {
+        options.cnf_encoding.encoding = cadical_itp::CnfEncoding::LUT;
+      } else {
+        return false;
+      }
+    } else if (argument == "--shared-aig") {
+      options.shared_aig = true;
+    } else if (argument == "--direct-aig") {
+      options.direct_aig = true;
+    } else if (argument == "--lut-size" && i + 1 < argc) {
+      options.cnf_encoding.lut_size = std::stoul(argv[++i]);
+    } else if (argument == "--aig-script" && i + 1 < argc) {
+      options.aig_optimization.script = cadical_itp::parse_aig_optimization_script(argv[++i]);
+      options.optimize_definitions = true;
+    } else if (argument == "--aig-passes" && i + 1 < argc) {
+      options.aig_optimization.max_passes = std::stoul(argv[++i]);
+    } else if (argument == "--aig-time-budget" && i + 1 < argc) {
+      options.aig_optimization.total_seconds = std::stod(argv[++i]);
+    } else if (argument == "--no-gates") {
+      options.gates = false;
+    } else if (argument == "--witnesses" && i + 1 < argc) {
+      options.witnesses = std::stoul(argv[++i]);
+    } else if (argument == "--replay-threads" && i + 1 < argc) {
+      options.replay_threads = std::stoul(argv[++i]);
+    } else if (argument == "--gc-watermark" && i + 1 < argc) {
+      options.gc_watermark_mb = std::stoul(argv[++i]);
+    } else if (argument == "--processes" && i + 1 < argc) {
+      options.processes = std::stoul(argv[++i]);
+    } else if (argument == "--threads" && i + 1 < argc) {
+      options.threads = std::stoul(argv[++i]);
+    } else if (argument == "--conflict-budget" && i + 1 < argc) {
+      options.budget.conflicts = std::stoll(argv[++i]);
+    } else if (argument == "--decision-budget" && i + 1 < argc) {
+      options.budget.decisions = std::stoll(argv[++i]);
+    } else if (argument == "--time-budget" && i + 1 < argc) {
+      options.budget.seconds = std::stod(argv[++i]);
+    } else if (argument == "--retries" && i + 1 < argc) {
+      options.retries = std::stoul(argv[++i]);
+    } else if (argument.starts_with("--") || !options.filename.empty()) {
+      return false;
+    } else {
+      options.filename = argument;
+    }
+  }
+  // Checkers are either spread over threads or over processes.
+  if (options.threads != 1 && options.processes != 1) {
+    return false;
+  }
+  // Threads steal tasks out of order, which a monotone shared set does not allow.
+  if (options.threads != 1 && options.monotone) {
+    return false;
+  }
+  return !options.filename.empty();
+}
+
+void configureChecker(Definabilitychecker& checker, const Options& options) {
+  checker.set_trusted_replay(options.trusted_replay);
+  checker.set_replay_threads(options.replay_threads);
+  checker.set_gc_watermark(options.gc_watermark_mb << 20);
+  checker.set_witness_pool_size(options.witnesses);
+  checker.set_slicing(options.slicing);
+  checker.set_aig_optimization(options.aig_optimization);
+  checker.set_proof_compression(options.proof_compression_seconds);
+  checker.set_cnf_encoding(options.cnf_encoding);
+  checker.set_shared_aig(options.shared_aig);
+  checker.set_direct_aig(options.direct_aig);
+  checker.set_gate_detection(options.gates);
+}
+
+// Outcome of checking one variable.
+struct CheckResult {
+  DefinabilityResult result;
+  double interpolation_seconds;
+  // Defined by the clauses of a gate, without solving.
+  bool gate = false;
+};
+
+// Checks whether variables[i] is defined by the variables before it.
+// defining_variables holds the prefix of a previous call and is adjusted to i.
+// In monotone mode the prefix is committed to the checker instead, so i must not decrease between calls.
+CheckResult checkVariable(Definabilitychecker& checker, bool monotone, bool optimize, cadical_itp::InterpolationSystem system, const std::vector<int>& variables, std::size_t i, const cadical_itp::SolveBudget& budget, std::vector<int>& defining_variables) {
+  if (monotone) {
+    assert(defining_variables.size() <= i);
+    checker.commit_shared_variables(std::span<const int>(variables).subspan(defining_variables.size(), i - defining_variables.size()));
+  } else {
+    defining_variables.resize(std::min(defining_variables.size(), i));
+  }
+  defining_variables.insert(defining_variables.end(), variables.begin() + defining_variables.size(), variables.begin() + i);
+  // Outputs of gates over earlier variables are defined by the gate clauses, so they do not go to the solver.
+  if (checker.find_gate_definition(variables[i], monotone ? std::vector<int>() : defining_variables)) {
+    return CheckResult{DefinabilityResult::DEFINED, 0, true};
+  }
+  CheckResult check_result{checker.check_definition(variables[i], monotone ? std::vector<int>() : defining_variables, {}, budget), 0};
+  if (check_result.result == DefinabilityResult::DEFINED) {
+    auto start = std::chrono::steady_clock::now();
+    checker.get_definition(optimize, system);
+    check_result.interpolation_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  return check_result;
+}
+
+// Checks the variables with the given indices one after the other.
+void checkVariables(Definabilitychecker& checker, bool monotone, bool optimize, cadical_itp::InterpolationSystem system, const std::vector<int>& variables, const std::vector<std::size_t>& tasks,
+                    const cadical_itp::SolveBudget& budget, std::vector<CheckResult>& results) {
+  std::vector<int> defining_variables;
+  for (std::size_t task = 0; task < tasks.size(); task++) {
+    displayProgress(static_cast<double>(task + 1) / static_cast<double>(tasks.size()));
+    results[tasks[task]] = checkVariable(checker, monotone, optimize, system, variables, tasks[task], budget, defining_variables);
+  }
+}
+
+// Checks the variables with the given indices on several threads, each owning a checker with the whole formula.
+// Whether variable i is defined only depends on the formula and the variables before it, so the
+// variables can be checked in any order.
+void checkVariablesParallel(const Options& options, unsigned nr_threads, const cadical_itp::ClauseArena& clauses, const std::vector<int>& variables,
+                            const std::vector<std::size_t>& tasks, const cadical_itp::SolveBudget& budget, std::vector<CheckResult>& results) {
+  cadical_itp::WorkStealingQueue queue(tasks.size(), nr_threads);
+  std::vector<std::exception_ptr> errors(nr_threads);
+  std::atomic<std::size_t> nr_checked = 0;
+  std::atomic<unsigned> nr_finished_threads = 0;
+
+  auto worker = [&](unsigned thread) {
+    try {
+      Definabilitychecker checker;
+      configureChecker(checker, options);
+      checker.append_formula(clauses);
+      std::vector<int> defining_variables;
+      std::size_t task;
+      while (queue.pop(thread, task)) {
+        // Stolen tasks may precede the ones checked before, so the shared set cannot be monotone.
+        results[tasks[task]] = checkVariable(checker, false, options.optimize_definitions, options.interpolation_system, variables, tasks[task], budget, defining_variables);
+        nr_checked++;
+      }
+    } catch (...) {
+      errors[thread] = std::current_exception();
+    }
+    nr_finished_threads++;
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned thread = 0; thread < nr_threads; thread++) {
+    threads.emplace_back(worker, thread);
+  }
+  while (nr_finished_threads < nr_threads) {
+    displayProgress(static_cast<double>(nr_checked) / static_cast<double>(tasks.size()));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  displayProgress(static_cast<double>(nr_checked) / static_cast<double>(tasks.size()));
+  for (auto& thread: threads) {
+    thread.join();
+  }
+  for (auto& error: errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+// Checks slices of the variables with the given indices in forked processes, which share
+// the loaded checker copy-on-write.
+void checkVariablesForked(const Options& options, unsigned nr_processes, Definabilitychecker& checker, const std::vector<int>& variables,
+                          const std::vector<std::size_t>& tasks, const cadical_itp::SolveBudget& budget, std::vector<CheckResult>& results) {
+  std::vector<int> defining_variables;
+  std::size_t nr_checked = 0;
+
+  cadical_itp::run_forked_workers<CheckResult>(nr_processes, tasks.size(),
+    [&](unsigned, std::size_t task) {
+      // Every process checks an ascending slice.
+      return checkVariable(checker, options.monotone, options.optimize_definitions, options.interpolation_system, variables, tasks[task], budget, defining_variables);
+    },
+    [&](std::size_t task, const CheckResult& result) {
+      results[tasks[task]] = result;
+      displayProgress(static_cast<double>(++nr_checked) / static_cast<double>(tasks.size()));
+    });
+}
+
 int main(int argc, char** argv) {
-  std::string filename(argv[1]);
+  Options options;
+  try {
+    if (!parseOptions(argc, argv, options)) {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+  catch (cadical_itp::AigOptimizerException& e) {
+    std::cout << e.what() << std::endl;
+    return 1;
+  }
+  catch (std::invalid_argument&) { // Numeric option value that is no number.
+    printUsage(argv[0]);
+    return 1;
+  }
+  catch (std::out_of_range&) {
+    printUsage(argv[0]);
+    return 1;
+  }
   try {
-    auto [num_variables, variables, is_existential, clauses] = parseQDIMACS(filename);
+    auto [num_variables, variables, is_existential, clauses] = parseQDIMACS(options.filename);
+
+    auto nr_threads = options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    auto nr_processes = options.processes > 0 ? options.processes : std::max(1u, std::thread::hardware_concurrency());
+    bool forked = nr_processes > 1 && variables.size() > 1;
+    bool parallel = !forked && nr_threads > 1 && variables.size() > 1;
+
+    // Sequential and forked checking share one checker, which is loaded once.
+    // Forked processes never modify the checker of the parent.
+    auto load_checker = [&]() {
+      auto checker = std::make_unique<Definabilitychecker>();
+      configureChecker(*checker, options);
+      checker->append_formula(clauses);
+      return checker;
+    };
+    std::unique_ptr<Definabilitychecker> checker;
+    if (!parallel) {
+      checker = load_checker();
+    }
 
-    Definabilitychecker checker;
-    checker.append_formula(clauses);
-    std::vector<int> defining_variables;
+    std::vector<CheckResult> results(variables.size(), CheckResult{DefinabilityResult::NOT_DEFINED, 0});
+    std::vector<std::size_t> tasks;
+    for (std::size_t i = 0; i < variables.size(); i++) {
+      if (is_existential[i]) {
+        tasks.push_back(i);
+      }
+    }
+    auto budget = options.budget;
+    for (unsigned pass = 0; !tasks.empty(); pass++) {
+      if (pass > 0) {
+        std::cout << std::endl << "Retrying " << tasks.size() << " unknown variables with a larger budget" << std::endl;
+      }
+      if (forked) {
+        checkVariablesForked(options, nr_processes, *checker, variables, tasks, budget, results);
+      } else if (parallel) {
+        checkVariablesParallel(options, nr_threads, clauses, variables, tasks, budget, results);
+      } else {
+        if (pass > 0 && options.monotone) {
+          // Committed variables cannot be taken back for the earlier variables of the retry pass.
+          checker = load_checker();
+        }
+        checkVariables(*checker, options.monotone, options.optimize_definitions, options.interpolation_system, variables, tasks, budget, results);
+      }
+      if (!budget.is_limited() || pass == options.retries) {
+        break;
+      }
+      // Run the variables whose budget was exhausted again with escalating limits.
+      std::vector<std::size_t> unknown_tasks;
+      for (auto i: tasks) {
+        if (results[i].result == DefinabilityResult::UNKNOWN) {
+          unknown_tasks.push_back(i);
+        }
+      }
+      tasks.swap(unknown_tasks);
+      budget = budget.scaled(BUDGET_GROWTH);
+    }
+
+    // Merge the results in prefix order.
     int nr_defined = 0;
+    int nr_unknown = 0;
     int nr_existential = 0;
-
+    int nr_gates = 0;
+    std::chrono::duration<double> interpolation_time(0);
     for (int i=0; i < variables.size(); i++) {
-      displayProgress(static_cast<double>(i+1) / static_cast<double>(num_variables));
-      auto v = variables[i];
       if (is_existential[i]) {
         nr_existential++;
-        if (checker.has_definition(v, defining_variables, {})) {
-          nr_defined++;
-          checker.get_definition(false);
-        }
+        nr_defined += results[i].result == DefinabilityResult::DEFINED;
+        nr_unknown += results[i].result == DefinabilityResult::UNKNOWN;
+        nr_gates += results[i].gate;
+        interpolation_time += std::chrono::duration<double>(results[i].interpolation_seconds);
       }
-      defining_variables.push_back(v);
     }
     std::cout << std::endl;
     std::cout << "Number of defined existential variables: " << nr_defined << "/" << nr_existential << std::endl;
+    if (options.gates) {
+      std::cout << "Number of existential variables defined by gates: " << nr_gates << "/" << nr_existential << std::endl;
+    }
+    if (options.budget.is_limited()) {
+      std::cout << "Number of existential variables with exhausted budget: " << nr_unknown << "/" << nr_existential << std::endl;
+    }
+    std::cout << "Time spent extracting definitions: " << std::setprecision(3) << interpolation_time.count() << "s" << std::endl;
   }
   catch (FileDoesNotExistException& e) {
     std::cout << e.what() << std::endl;
     return 1;
   }
+  catch (ParseException& e) {
+    std::cout << e.what() << std::endl;
+    return 1;
+  }
+  catch (cadical_itp::ForkedWorkerException& e) {
+    std::cout << e.what() << std::endl;
+    return 1;
+  }
 
   return 0;
 }
@@ -0,0 +1,412 @@
+#include "proof_compression.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cadical_itp {
+
+namespace {
+
+constexpr uint32_t NO_NODE = std::numeric_limits<uint32_t>::max();
+// Number of nodes processed between two looks at the clock.
+constexpr std::size_t CLOCK_INTERVAL = 1 << 12;
+
+class TimeoutException {};
+// Thrown if fixing the proof would resolve to a tautology, which the interpolation systems do not support.
+class TautologyException {};
+
+// The proof as a DAG of binary resolutions, with the clause of every node as a sorted literal vector.
+// Node ids are a topological order: premises have smaller ids than their resolvents.
+class ProofCompressor {
+ public:
+  ProofCompressor(ProofnodeArena& proofnodes, double seconds, ProofCompressionStatistics& statistics);
+  ProofnodeIndex compress(ProofnodeIndex root);
+
+ private:
+  enum class Action : uint8_t {
+    RESOLVE,
+    KEEP_LEFT,
+    KEEP_RIGHT
+  };
+
+  struct Node {
+    // Antecedents of a resolution contain the pivot literal, resolvents so far its negation.
+    int pivot;
+    uint32_t left;
+    uint32_t right;
+    // Proofnode of a leaf, or NO_PROOFNODE.
+    ProofnodeIndex proofnode;
+  };
+
+  void tick();
+  uint32_t add_leaf(ProofnodeIndex proofnode, std::span<const int> literals);
+  uint32_t add_resolution(int pivot, uint32_t left, uint32_t right);
+  uint32_t expand(ProofnodeIndex root);
+  void lower_units(uint32_t root);
+  void recycle_pivots(uint32_t root);
+  void contribute(uint32_t node, const std::vector<int>& safe_literals);
+  uint32_t resolve_fixed(int pivot, uint32_t left, uint32_t right);
+  uint32_t fix(uint32_t root);
+  std::size_t count_resolutions(uint32_t root) const;
+  ProofnodeIndex rebuild(uint32_t root);
+
+  static bool contains(const std::vector<int>& clause, int literal) { return std::ranges::binary_search(clause, literal); }
+
+  ProofnodeArena& proofnodes;
+  double seconds;
+  ProofCompressionStatistics& statistics;
+  std::chrono::steady_clock::time_point start;
+  std::size_t nr_ticks;
+
+  std::vector<Node> nodes;
+  std::vector<std::vector<int>> clauses;
+  // Lowered units in the order they are resolved with the root, i.e. from the root upwards.
+  std::vector<uint32_t> units;
+  std::vector<bool> lowered;
+  // RecyclePivots: literals removed below a node on all paths to the root.
+  std::vector<std::vector<int>> safe;
+  std::vector<bool> reached;
+  std::vector<Action> actions;
+  std::vector<uint32_t> replacements;
+  std::size_t nr_recycled_pivots;
+};
+
+ProofCompressor::ProofCompressor(ProofnodeArena& proofnodes, double seconds, ProofCompressionStatistics& statistics):
+  proofnodes(proofnodes), seconds(seconds), statistics(statistics), start(std::chrono::steady_clock::now()), nr_ticks(0), nr_recycled_pivots(0) {}
+
+void ProofCompressor::tick() {
+  if (seconds > 0 && ++nr_ticks % CLOCK_INTERVAL == 0 &&
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > seconds) {
+    throw TimeoutException();
+  }
+}
+
+uint32_t ProofCompressor::add_leaf(ProofnodeIndex proofnode, std::span<const int> literals) {
+  std::vector<int> clause(literals.begin(), literals.end());
+  std::ranges::sort(clause);
+  clause.erase(std::unique(clause.begin(), clause.end()), clause.end());
+  nodes.push_back(Node{0, NO_NODE, NO_NODE, proofnode});
+  clauses.push_back(std::move(clause));
+  return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+uint32_t ProofCompressor::add_resolution(int pivot, uint32_t left, uint32_t right) {
+  tick();
+  const auto& left_clause = clauses[left];
+  const auto& right_clause = clauses[right];
+  std::vector<int> clause;
+  clause.reserve(left_clause.size() + right_clause.size());
+  // Sorted union of both clauses without the pivot literals.
+  std::size_t i = 0, j = 0;
+  while (i < left_clause.size() || j < right_clause.size()) {
+    if (i < left_clause.size() && left_clause[i] == -pivot) {
+      i++;
+    } else if (j < right_clause.size() && right_clause[j] == pivot) {
+      j++;
+    } else if (j == right_clause.size() || (i < left_clause.size() && left_clause[i] < right_clause[j])) {
+      clause.push_back(left_clause[i++]);
+    } else if (i == left_clause.size() || right_clause[j] < left_clause[i]) {
+      clause.push_back(right_clause[j++]);
+    } else {
+      clause.push_back(left_clause[i++]);
+      j++;
+    }
+  }
+  nodes.push_back(Node{pivot, left, right, NO_PROOFNODE});
+  clauses.push_back(std::move(clause));
+  return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+// Turn the chains below root into binary resolutions, children first. The map only holds the
+// Proofnodes of the cone of root, which is usually a small part of the arena.
+uint32_t ProofCompressor::expand(ProofnodeIndex root) {
+  std::unordered_map<ProofnodeIndex, uint32_t> node_of;
+  auto get_node = [&node_of](ProofnodeIndex index) {
+    auto it = node_of.find(index);
+    return it == node_of.end() ? NO_NODE : it->second;
+  };
+  std::vector<ProofnodeIndex> stack{root};
+  while (!stack.empty()) {
+    auto index = stack.back();
+    if (node_of.contains(index)) {
+      stack.pop_back();
+      continue;
+    }
+    const auto& proofnode = proofnodes[index];
+    if (proofnode.type != ProofnodeType::CHAIN) {
+      stack.pop_back();
+      node_of.emplace(index, add_leaf(index, proofnodes.get_literals(proofnode)));
+      continue;
+    }
+    bool children_pending = false;
+    for (uint32_t step = proofnode.size; step-- > 0;) {
+      auto antecedent = proofnodes.get_antecedent(proofnode, step);
+      if (!node_of.contains(antecedent)) {
+        stack.push_back(antecedent);
+        children_pending = true;
+      }
+    }
+    auto chain_start = proofnodes.get_chain_start(proofnode);
+    if (!node_of.contains(chain_start)) {
+      stack.push_back(chain_start);
+      children_pending = true;
+    }
+    if (children_pending) {
+      continue;
+    }
+    stack.pop_back();
+    auto resolvent = get_node(chain_start);
+    for (uint32_t step = 0; step < proofnode.size; step++) {
+      resolvent = add_resolution(proofnodes.get_pivot(proofnode, step), resolvent, get_node(proofnodes.get_antecedent(proofnode, step)));
+    }
+    node_of.emplace(index, resolvent);
+  }
+  return get_node(root);
+}
+
+// LowerUnits: units with several parents are removed from the proof and resolved with the root instead.
+void ProofCompressor::lower_units(uint32_t root) {
+  std::vector<uint32_t> nr_parents(nodes.size(), 0);
+  for (const auto& node: nodes) {
+    if (node.pivot != 0) {
+      nr_parents[node.left]++;
+      nr_parents[node.right]++;
+    }
+  }
+  lowered.assign(nodes.size(), false);
+  // A lowered unit may depend on units above it, whose negations it then contains, so they are
+  // resolved with the root later.
+  for (auto node = root; node-- > 0;) {
+    if (clauses[node].size() == 1 && nr_parents[node] > 1) {
+      lowered[node] = true;
+      units.push_back(node);
+    }
+  }
+}
+
+void ProofCompressor::contribute(uint32_t node, const std::vector<int>& safe_literals) {
+  if (!reached[node]) {
+    reached[node] = true;
+    safe[node] = safe_literals;
+    return;
+  }
+  auto& node_safe = safe[node];
+  std::erase_if(node_safe, [&safe_literals](int l) { return !contains(safe_literals, l); });
+}
+
+// RecyclePivotsWithIntersection, top-down: a resolution whose pivot literal is removed below anyway
+// on all paths is replaced by the premise containing that literal. Resolutions with a lowered unit
+// are replaced by the other premise.
+void ProofCompressor::recycle_pivots(uint32_t root) {
+  safe.assign(nodes.size(), {});
+  reached.assign(nodes.size(), false);
+  actions.assign(nodes.size(), Action::RESOLVE);
+  // The negations of lowered units are removed by the final resolutions with the units.
+  std::vector<int> root_safe;
+  for (auto unit: units) {
+    root_safe.push_back(-clauses[unit].front());
+    reached[unit] = true;
+  }
+  std::ranges::sort(root_safe);
+  contribute(root, root_safe);
+  std::vector<int> premise_safe;
+  for (auto n = root + 1; n-- > 0;) {
+    tick();
+    const auto& node = nodes[n];
+    if (!reached[n] || node.pivot == 0) {
+      continue;
+    }
+    auto& node_safe = safe[n];
+    if (lowered[node.right]) {
+      actions[n] = Action::KEEP_LEFT;
+    } else if (lowered[node.left]) {
+      actions[n] = Action::KEEP_RIGHT;
+    } else if (contains(node_safe, node.pivot)) {
+      actions[n] = Action::KEEP_RIGHT;
+      nr_recycled_pivots++;
+    } else if (contains(node_safe, -node.pivot)) {
+      actions[n] = Action::KEEP_LEFT;
+      nr_recycled_pivots++;
+    }
+    if (actions[n] == Action::KEEP_LEFT) {
+      contribute(node.left, node_safe);
+    } else if (actions[n] == Action::KEEP_RIGHT) {
+      contribute(node.right, node_safe);
+    } else {
+      for (auto [premise, literal]: {std::pair{node.left, -node.pivot}, std::pair{node.right, node.pivot}}) {
+        premise_safe = node_safe;
+        premise_safe.insert(std::ranges::lower_bound(premise_safe, literal), literal);
+        contribute(premise, premise_safe);
+      }
+    }
+    std::vector<int>().swap(node_safe);
+  }
+}
+
+// Resolve fixed premises. A premise that lost its pivot literal replaces the resolution.
+uint32_t ProofCompressor::resolve_fixed(int pivot, uint32_t left, uint32_t right) {
+  bool left_has_pivot = contains(clauses[left], -pivot);
+  bool right_has_pivot = contains(clauses[right], pivot);
+  if (!left_has_pivot && !right_has_pivot) {
+    return clauses[left].size() <= clauses[right].size() ? left : right;
+  } else if (!left_has_pivot) {
+    return left;
+  } else if (!right_has_pivot) {
+    return right;
+  }
+  auto resolvent = add_resolution(pivot, left, right);
+  const auto& clause = clauses[resolvent];
+  if (std::ranges::any_of(clause, [&clause](int l) { return l > 0 && contains(clause, -l); })) {
+    throw TautologyException();
+  }
+  return resolvent;
+}
+
+// Rebuild the proof bottom-up according to the actions and resolve the root with the lowered units.
+uint32_t ProofCompressor::fix(uint32_t root) {
+  auto nr_original_nodes = nodes.size();
+  replacements.assign(nr_original_nodes, NO_NODE);
+  for (uint32_t n = 0; n < nr_original_nodes; n++) {
+    if (!reached[n]) {
+      continue;
+    }
+    auto node = nodes[n];
+    if (node.pivot == 0) {
+      replacements[n] = n;
+    } else if (actions[n] == Action::KEEP_LEFT) {
+      replacements[n] = replacements[node.left];
+    } else if (actions[n] == Action::KEEP_RIGHT) {
+      replacements[n] = replacements[node.right];
+    } else if (replacements[node.left] == node.left && replacements[node.right] == node.right) {
+      replacements[n] = n;
+    } else {
+      replacements[n] = resolve_fixed(node.pivot, replacements[node.left], replacements[node.right]);
+    }
+  }
+  auto fixed_root = replacements[root];
+  for (auto unit: units) {
+    fixed_root = resolve_fixed(clauses[unit].front(), fixed_root, replacements[unit]);
+  }
+  return fixed_root;
+}
+
+std::size_t ProofCompressor::count_resolutions(uint32_t root) const {
+  std::vector<bool> visited(nodes.size(), false);
+  std::vector<uint32_t> stack{root};
+  std::size_t nr_resolutions = 0;
+  while (!stack.empty()) {
+    auto n = stack.back();
+    stack.pop_back();
+    if (visited[n] || nodes[n].pivot == 0) {
+      continue;
+    }
+    visited[n] = true;
+    nr_resolutions++;
+    stack.push_back(nodes[n].left);
+    stack.push_back(nodes[n].right);
+  }
+  return nr_resolutions;
+}
+
+// Append the proof of root to the arena. Resolutions whose only use is as the left premise of
+// another one are merged into its chain.
+ProofnodeIndex ProofCompressor::rebuild(uint32_t root) {
+  std::vector<uint32_t> nr_uses(nodes.size(), 0);
+  std::vector<bool> live(nodes.size(), false);
+  std::vector<uint32_t> stack{root};
+  live[root] = true;
+  while (!stack.empty()) {
+    auto n = stack.back();
+    stack.pop_back();
+    if (nodes[n].pivot == 0) {
+      continue;
+    }
+    for (auto premise: {nodes[n].left, nodes[n].right}) {
+      nr_uses[premise]++;
+      if (!live[premise]) {
+        live[premise] = true;
+        stack.push_back(premise);
+      }
+    }
+  }
+  std::vector<bool> in_chain(nodes.size(), false);
+  for (uint32_t n = 0; n < nodes.size(); n++) {
+    if (live[n] && nodes[n].pivot != 0 && nodes[nodes[n].left].pivot != 0 && nr_uses[nodes[n].left] == 1) {
+      in_chain[nodes[n].left] = true;
+    }
+  }
+  std::vector<ProofnodeIndex> proofnode_of(nodes.size(), NO_PROOFNODE);
+  std::vector<int> pivots;
+  std::vector<ProofnodeIndex> antecedents;
+  for (uint32_t n = 0; n < nodes.size(); n++) {
+    if (!live[n]) {
+      continue;
+    }
+    if (nodes[n].pivot == 0) {
+      proofnode_of[n] = nodes[n].proofnode;
+      continue;
+    }
+    if (in_chain[n]) {
+      continue;
+    }
+    pivots.clear();
+    antecedents.clear();
+    auto chain_start = n;
+    do {
+      pivots.push_back(nodes[chain_start].pivot);
+      antecedents.push_back(proofnode_of[nodes[chain_start].right]);
+      chain_start = nodes[chain_start].left;
+    } while (in_chain[chain_start]);
+    std::ranges::reverse(pivots);
+    std::ranges::reverse(antecedents);
+    proofnode_of[n] = proofnodes.create_chain(proofnode_of[chain_start], pivots, antecedents);
+  }
+  return proofnode_of[root];
+}
+
+ProofnodeIndex ProofCompressor::compress(ProofnodeIndex root) {
+  if (proofnodes[root].type != ProofnodeType::CHAIN) {
+    return root;
+  }
+  uint32_t expanded_root, fixed_root;
+  try {
+    expanded_root = expand(root);
+    lower_units(expanded_root);
+    recycle_pivots(expanded_root);
+    fixed_root = fix(expanded_root);
+  } catch (TimeoutException&) {
+    statistics.timeouts++;
+    return root;
+  } catch (TautologyException&) {
+    return root;
+  }
+  auto nr_resolutions = count_resolutions(expanded_root);
+  auto nr_fixed_resolutions = count_resolutions(fixed_root);
+  statistics.resolutions_before += nr_resolutions;
+  // The compressed proof must not derive more than the original one.
+  if (nr_fixed_resolutions >= nr_resolutions || !std::ranges::includes(clauses[expanded_root], clauses[fixed_root])) {
+    statistics.resolutions_after += nr_resolutions;
+    return root;
+  }
+  statistics.resolutions_after += nr_fixed_resolutions;
+  statistics.lowered_units += units.size();
+  statistics.recycled_pivots += nr_recycled_pivots;
+  return rebuild(fixed_root);
+}
+
+}
+
+ProofnodeIndex compress_proof(ProofnodeArena& proofnodes, ProofnodeIndex root, double seconds, ProofCompressionStatistics& statistics) {
+  auto start = std::chrono::steady_clock::now();
+  statistics.runs++;
+  auto compressed_root = ProofCompressor(proofnodes, seconds, statistics).compress(root);
+  statistics.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return compressed_root;
+}
+
+}
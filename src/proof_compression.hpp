@@ -0,0 +1,30 @@
+#ifndef ITP_PROOF_COMPRESSION_H_
+#define ITP_PROOF_COMPRESSION_H_
+
+#include <cstdint>
+
+#include "proofnode.hpp"
+
+namespace cadical_itp {
+
+struct ProofCompressionStatistics {
+  uint64_t runs = 0;
+  // Binary resolutions in the proofs before and after compression.
+  uint64_t resolutions_before = 0;
+  uint64_t resolutions_after = 0;
+  uint64_t lowered_units = 0;
+  // Resolutions dropped by RecyclePivots.
+  uint64_t recycled_pivots = 0;
+  uint64_t timeouts = 0;
+  double seconds = 0;
+};
+
+// Compress the proof of root with LowerUnits and RecyclePivotsWithIntersection.
+// The compressed proof is appended to the arena and derives a subset of the clause of root; the
+// nodes of the original proof are left untouched. Returns root itself if nothing could be removed
+// or the time limit (in seconds, 0 for none) was reached.
+ProofnodeIndex compress_proof(ProofnodeArena& proofnodes, ProofnodeIndex root, double seconds, ProofCompressionStatistics& statistics);
+
+}
+
+#endif // ITP_PROOF_COMPRESSION_H_
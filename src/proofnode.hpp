@@ -0,0 +1,197 @@
+#ifndef ITP_PROOFNODE_H_
+#define ITP_PROOFNODE_H_
+
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <span>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <cassert>
+
+namespace cadical_itp {
+
+using ProofnodeIndex = uint32_t;
+
+constexpr ProofnodeIndex NO_PROOFNODE = std::numeric_limits<ProofnodeIndex>::max();
+
+enum class ProofnodeType : uint32_t {
+  CLAUSE,             // Clause of the first part, operands are its literals.
+  SECOND_PART_CLAUSE, // Clause of the second part, operands are its literals.
+  CHAIN               // Resolution chain, operands are the start node followed by (pivot, antecedent) pairs.
+                      // Pivots are the literals as they occur in the antecedents.
+};
+
+struct Proofnode {
+  uint64_t begin;
+  uint32_t size;
+  ProofnodeType type;
+};
+
+// Bump allocator for proof nodes, addressed by 32-bit indices.
+// Nodes are stored in fixed-size chunks, so growing the pool never moves existing nodes.
+// Variable-length operands live in a separate flat buffer.
+// Children are always created before their parents, hence indices are a topological order.
+class ProofnodeArena {
+ public:
+  ProofnodeIndex create_clause(std::span<const int> literals, bool first_part);
+  // A chain without steps is represented by its start node.
+  ProofnodeIndex create_chain(ProofnodeIndex start, std::span<const int> pivots, std::span<const ProofnodeIndex> antecedents);
+  const Proofnode& operator[](ProofnodeIndex index) const;
+  std::span<const int> get_literals(const Proofnode& node) const;
+  ProofnodeIndex get_chain_start(const Proofnode& node) const;
+  int get_pivot(const Proofnode& node, uint32_t step) const;
+  ProofnodeIndex get_antecedent(const Proofnode& node, uint32_t step) const;
+  std::size_t size() const { return nr_nodes; }
+  // Bytes held by nodes and operands, including unused capacity.
+  std::size_t memory_usage() const;
+  // Release all nodes at once.
+  void clear();
+  // Release the nodes created after the first size ones.
+  void truncate(std::size_t size);
+  // Mark-compact garbage collection: keep only the nodes reachable from roots and slide them
+  // down, preserving their order. Returns the new index of every old node (NO_PROOFNODE if reclaimed).
+  std::vector<ProofnodeIndex> compact(std::span<const ProofnodeIndex> roots);
+
+ private:
+  static constexpr unsigned CHUNK_BITS = 16;
+  static constexpr ProofnodeIndex CHUNK_SIZE = 1u << CHUNK_BITS;
+
+  ProofnodeIndex allocate(const Proofnode& node);
+  Proofnode& get_node(ProofnodeIndex index) { return chunks[index >> CHUNK_BITS][index & (CHUNK_SIZE - 1)]; }
+
+  std::vector<std::unique_ptr<Proofnode[]>> chunks;
+  std::size_t nr_nodes = 0;
+  std::vector<int> operands;
+};
+
+inline ProofnodeIndex ProofnodeArena::allocate(const Proofnode& node) {
+  if (nr_nodes == NO_PROOFNODE) {
+    throw std::length_error("proof node arena exhausted");
+  }
+  if ((nr_nodes >> CHUNK_BITS) == chunks.size()) {
+    chunks.emplace_back(new Proofnode[CHUNK_SIZE]);
+  }
+  auto index = static_cast<ProofnodeIndex>(nr_nodes++);
+  chunks[index >> CHUNK_BITS][index & (CHUNK_SIZE - 1)] = node;
+  return index;
+}
+
+inline ProofnodeIndex ProofnodeArena::create_clause(std::span<const int> literals, bool first_part) {
+  auto begin = operands.size();
+  operands.insert(operands.end(), literals.begin(), literals.end());
+  return allocate(Proofnode{begin, static_cast<uint32_t>(literals.size()), first_part ? ProofnodeType::CLAUSE : ProofnodeType::SECOND_PART_CLAUSE});
+}
+
+inline ProofnodeIndex ProofnodeArena::create_chain(ProofnodeIndex start, std::span<const int> pivots, std::span<const ProofnodeIndex> antecedents) {
+  assert(pivots.size() == antecedents.size());
+  if (pivots.empty()) {
+    return start;
+  }
+  auto begin = operands.size();
+  operands.push_back(static_cast<int>(start));
+  for (std::size_t i = 0; i < pivots.size(); i++) {
+    operands.push_back(pivots[i]);
+    operands.push_back(static_cast<int>(antecedents[i]));
+  }
+  return allocate(Proofnode{begin, static_cast<uint32_t>(pivots.size()), ProofnodeType::CHAIN});
+}
+
+inline const Proofnode& ProofnodeArena::operator[](ProofnodeIndex index) const {
+  return chunks[index >> CHUNK_BITS][index & (CHUNK_SIZE - 1)];
+}
+
+inline std::span<const int> ProofnodeArena::get_literals(const Proofnode& node) const {
+  assert(node.type != ProofnodeType::CHAIN);
+  return std::span<const int>(operands.data() + node.begin, node.size);
+}
+
+inline ProofnodeIndex ProofnodeArena::get_chain_start(const Proofnode& node) const {
+  assert(node.type == ProofnodeType::CHAIN);
+  return static_cast<ProofnodeIndex>(operands[node.begin]);
+}
+
+inline int ProofnodeArena::get_pivot(const Proofnode& node, uint32_t step) const {
+  assert(node.type == ProofnodeType::CHAIN && step < node.size);
+  return operands[node.begin + 1 + 2 * step];
+}
+
+inline ProofnodeIndex ProofnodeArena::get_antecedent(const Proofnode& node, uint32_t step) const {
+  assert(node.type == ProofnodeType::CHAIN && step < node.size);
+  return static_cast<ProofnodeIndex>(operands[node.begin + 2 + 2 * step]);
+}
+
+inline void ProofnodeArena::clear() {
+  // Keep the first chunk around for reuse.
+  if (chunks.size() > 1) {
+    chunks.resize(1);
+  }
+  nr_nodes = 0;
+  operands.clear();
+}
+
+inline void ProofnodeArena::truncate(std::size_t size) {
+  if (size >= nr_nodes) {
+    return;
+  }
+  operands.resize((*this)[size].begin);
+  nr_nodes = size;
+}
+
+inline std::size_t ProofnodeArena::memory_usage() const {
+  return chunks.size() * CHUNK_SIZE * sizeof(Proofnode) + operands.capacity() * sizeof(int);
+}
+
+inline std::vector<ProofnodeIndex> ProofnodeArena::compact(std::span<const ProofnodeIndex> roots) {
+  // Mark: children have smaller indices than their parents, so a single downward sweep suffices.
+  std::vector<ProofnodeIndex> forwarding(nr_nodes, NO_PROOFNODE);
+  for (auto root: roots) {
+    forwarding[root] = 0;
+  }
+  for (auto index = nr_nodes; index-- > 0;) {
+    const auto& node = (*this)[index];
+    if (forwarding[index] == NO_PROOFNODE || node.type != ProofnodeType::CHAIN) {
+      continue;
+    }
+    forwarding[get_chain_start(node)] = 0;
+    for (uint32_t step = 0; step < node.size; step++) {
+      forwarding[get_antecedent(node, step)] = 0;
+    }
+  }
+  // Compact: operands are laid out in node order, so both nodes and operands only move down.
+  ProofnodeIndex nr_live = 0;
+  std::size_t nr_live_operands = 0;
+  for (std::size_t index = 0; index < nr_nodes; index++) {
+    if (forwarding[index] == NO_PROOFNODE) {
+      continue;
+    }
+    auto node = get_node(index);
+    auto nr_operands = node.type == ProofnodeType::CHAIN ? 2 * std::size_t(node.size) + 1 : std::size_t(node.size);
+    if (node.begin != nr_live_operands) {
+      std::copy(operands.begin() + node.begin, operands.begin() + node.begin + nr_operands, operands.begin() + nr_live_operands);
+      node.begin = nr_live_operands;
+    }
+    if (node.type == ProofnodeType::CHAIN) {
+      // Children were moved already.
+      auto& start = operands[node.begin];
+      start = static_cast<int>(forwarding[start]);
+      for (uint32_t step = 0; step < node.size; step++) {
+        auto& antecedent = operands[node.begin + 2 + 2 * step];
+        antecedent = static_cast<int>(forwarding[antecedent]);
+      }
+    }
+    nr_live_operands += nr_operands;
+    forwarding[index] = nr_live;
+    get_node(nr_live++) = node;
+  }
+  nr_nodes = nr_live;
+  chunks.resize(std::max<std::size_t>(1, (nr_nodes + CHUNK_SIZE - 1) >> CHUNK_BITS));
+  operands.resize(nr_live_operands);
+  operands.shrink_to_fit();
+  return forwarding;
+}
+
+}
+
+#endif // ITP_PROOFNODE_H_
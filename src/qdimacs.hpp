@@ -1,65 +1,248 @@
 #ifndef QDIMACS_HPP_
 #define QDIMACS_HPP_
 
-#include <fstream>
-#include <sstream>
 #include <vector>
 #include <string>
 #include <exception>
 #include <tuple>
+#include <utility>
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "clause_arena.hpp"
 
 class FileDoesNotExistException: public std::exception {
  public:
-  FileDoesNotExistException(const std::string& filename): filename(filename) {}
+  FileDoesNotExistException(const std::string& filename): message("File does not exist: " + filename) {}
 
   const char* what() const noexcept override {
-    std::string message = "File does not exist: " + filename;
     return message.c_str();
   }
 
  private:
-  std::string filename;
+  std::string message;
+};
+
+class ParseException: public std::exception {
+ public:
+  ParseException(const std::string& filename, std::size_t line, const std::string& reason):
+    message(filename + ":" + std::to_string(line) + ": " + reason) {}
+
+  const char* what() const noexcept override {
+    return message.c_str();
+  }
+
+ private:
+  std::string message;
+};
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+ public:
+  MappedFile(const std::string& filename): data(nullptr), size(0) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw FileDoesNotExistException(filename);
+    struct stat file_status;
+    if (fstat(fd, &file_status) == 0 && file_status.st_size > 0) {
+      size = file_status.st_size;
+      void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapping != MAP_FAILED) {
+        data = static_cast<const char*>(mapping);
+        madvise(mapping, size, MADV_SEQUENTIAL);
+      }
+    }
+    close(fd);
+    if (size > 0 && data == nullptr)
+      throw ParseException(filename, 0, "could not map file");
+  }
+
+  ~MappedFile() {
+    if (data)
+      munmap(const_cast<char*>(data), size);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* begin() const { return data; }
+  const char* end() const { return data + size; }
+  std::size_t get_size() const { return size; }
+
+ private:
+  const char* data;
+  std::size_t size;
+};
+
+// Tokenizer over a mapped QDIMACS file that keeps track of the current line.
+class QDIMACSScanner {
+ public:
+  QDIMACSScanner(const std::string& filename, const char* begin, const char* end): filename(filename), p(begin), end(end), line(1) {}
+
+  // Skip blanks and newlines. Returns the next character, or 0 at the end of the file.
+  char skip_whitespace() {
+    while (p < end) {
+      char ch = *p;
+      if (ch == '\n')
+        line++;
+      else if (ch != ' ' && ch != '\t' && ch != '\r' && ch != '\f' && ch != '\v')
+        return ch;
+      p++;
+    }
+    return 0;
+  }
+
+  // Skip blanks on the current line. Returns the next character, '\n' at the end of the line, or 0 at the end of the file.
+  char skip_blanks() {
+    while (p < end) {
+      char ch = *p;
+      if (ch != ' ' && ch != '\t' && ch != '\r' && ch != '\f' && ch != '\v')
+        return ch;
+      p++;
+    }
+    return 0;
+  }
+
+  // Move past the end of the current line (memchr is vectorized in libc).
+  void skip_line() {
+    auto newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    if (newline) {
+      p = newline + 1;
+      line++;
+    } else {
+      p = end;
+    }
+  }
+
+  void expect_end_of_line() {
+    char ch = skip_blanks();
+    if (ch != '\n' && ch != 0)
+      error(std::string("unexpected character '") + ch + "'");
+  }
+
+  std::string read_word() {
+    auto start = p;
+    while (p < end && *p > ' ')
+      p++;
+    return std::string(start, p);
+  }
+
+  int read_integer() {
+    bool negative = false;
+    if (p < end && *p == '-') {
+      negative = true;
+      p++;
+    }
+    if (p == end || static_cast<unsigned char>(*p - '0') > 9)
+      error("expected integer");
+    long long value = 0;
+    do {
+      value = 10 * value + (*p++ - '0');
+      if (value > INT_MAX)
+        error("integer out of range");
+    } while (p < end && static_cast<unsigned char>(*p - '0') <= 9);
+    if (p < end && *p > ' ')
+      error(std::string("unexpected character '") + *p + "'");
+    return negative ? -static_cast<int>(value) : static_cast<int>(value);
+  }
+
+  void advance() { p++; }
+  std::size_t get_line() const { return line; }
+
+  [[noreturn]] void error(const std::string& reason) const {
+    throw ParseException(filename, line, reason);
+  }
+
+ private:
+  const std::string& filename;
+  const char* p;
+  const char* end;
+  std::size_t line;
 };
 
 auto parseQDIMACS(const std::string& filename) {
-  std::ifstream file(filename);
-  if (!file)
-    throw FileDoesNotExistException(filename);
+  MappedFile file(filename);
+  QDIMACSScanner scanner(filename, file.begin(), file.end());
 
-  std::string line, buffer;
-  int num_variables, num_clauses;
+  int num_variables = 0, num_clauses = 0, max_variable = 0;
+  bool header_seen = false;
   std::vector<int> variables;
   std::vector<bool> is_existential;
-  std::vector<std::vector<int>> clauses;
-
-  while (std::getline(file, line)) {
-    if (line.empty())
-      continue;
-    std::istringstream iss(line);
-    char ch;
-    iss >> ch;
-    if (ch == 'c') // Comment line
-      continue;
-    else if (ch == 'p') // Header line
-      iss >> buffer >> num_variables >> num_clauses;
-    else if (ch == 'a' || ch == 'e') { // Quantifier line
+  cadical_itp::ClauseArena clauses;
+
+  while (char ch = scanner.skip_whitespace()) {
+    if (ch == 'c') { // Comment line
+      scanner.skip_line();
+    } else if (ch == 'p') { // Header line
+      if (header_seen)
+        scanner.error("duplicate header");
+      scanner.advance();
+      scanner.skip_blanks();
+      if (scanner.read_word() != "cnf")
+        scanner.error("expected 'p cnf <variables> <clauses>'");
+      scanner.skip_blanks();
+      num_variables = scanner.read_integer();
+      scanner.skip_blanks();
+      num_clauses = scanner.read_integer();
+      if (num_variables < 0 || num_clauses < 0)
+        scanner.error("negative count in header");
+      scanner.expect_end_of_line();
+      header_seen = true;
+      // Most literals take at least four characters with their separator, which keeps the
+      // reservation at about the file size in bytes. Denser files grow the arena geometrically.
+      clauses.reserve(num_clauses, file.get_size() / 4);
+    } else if (ch == 'a' || ch == 'e') { // Quantifier line
+      if (!header_seen)
+        scanner.error("quantifier block before header");
+      if (!clauses.empty())
+        scanner.error("quantifier block after clauses");
       bool existential = (ch == 'e');
+      scanner.advance();
       int variable;
-      while (iss >> variable, variable != 0) {
+      while (true) {
+        char next = scanner.skip_blanks();
+        if (next == '\n' || next == 0)
+          scanner.error("quantifier block not terminated by 0");
+        variable = scanner.read_integer();
+        if (variable == 0)
+          break;
+        if (variable < 0)
+          scanner.error("invalid variable " + std::to_string(variable) + " in quantifier block");
+        max_variable = std::max(max_variable, variable);
         variables.push_back(variable);
         is_existential.push_back(existential);
       }
-    }
-    else {// Clause line
-      iss.putback(ch);
-      std::vector<int> clause;
-      int literal;
-      while(iss >> literal, literal != 0)
-        clause.push_back(literal);
-      clauses.push_back(clause);
+      scanner.expect_end_of_line();
+    } else if (ch == '%') { // End marker of SATLIB benchmarks, everything after it is ignored.
+      break;
+    } else { // Clause, which may span several lines.
+      if (!header_seen)
+        scanner.error("clause before header");
+      while (true) {
+        if (scanner.skip_whitespace() == 0)
+          scanner.error("clause not terminated by 0");
+        int literal = scanner.read_integer();
+        if (literal == 0)
+          break;
+        max_variable = std::max(max_variable, std::abs(literal));
+        clauses.add_literal(literal);
+      }
+      clauses.finish_clause();
     }
   }
-  return std::make_tuple(num_variables, variables, is_existential, clauses);
+  if (!header_seen)
+    scanner.error("missing header");
+  // Variables beyond the header's count are accepted, as by earlier versions; callers size their
+  // tables by the returned count.
+  num_variables = std::max(num_variables, max_variable);
+  return std::make_tuple(num_variables, std::move(variables), std::move(is_existential), std::move(clauses));
 }
 
-#endif // QDIMACS_HPP_
\ No newline at end of file
+#endif // QDIMACS_HPP_
@@ -0,0 +1,137 @@
+#ifndef WITNESS_POOL_H_
+#define WITNESS_POOL_H_
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+// Bounded pool of witnesses of non-definability: pairs of models of the two copies of the formula.
+// If the copies of y differ in a witness while the copies of all shared variables agree, y is not
+// defined by these shared variables, no matter which query produced the witness.
+// Witnesses are stored transposed: every variable has one bit per witness telling whether its copies
+// differ, so a query is screened against 64 witnesses per word operation.
+class WitnessPool {
+ public:
+  struct Statistics {
+    uint64_t added = 0;
+    uint64_t screened = 0;
+    uint64_t refuted = 0;
+  };
+
+  explicit WitnessPool(std::size_t capacity = 256) { set_capacity(capacity); }
+  // Rounded up to a multiple of 64. Drops all witnesses; 0 disables the pool.
+  void set_capacity(std::size_t capacity);
+  // Drop all witnesses, e.g. when clauses are added: they need not be models of the new formula.
+  void clear();
+  // Add a witness, given by the variables whose copies differ. Replaces the oldest one when full.
+  // always_shared flags variables that are shared in every query (committed variables).
+  void add(std::span<const int> differing_variables, const std::vector<bool>& always_shared);
+  // Make variable shared in every following query.
+  void add_always_shared(int variable);
+  // True if some witness shows that variable is not defined by shared_variables and the always shared ones.
+  bool refutes(int variable, std::span<const int> shared_variables);
+  bool enabled() const { return nr_words > 0; }
+  const Statistics& get_statistics() const { return statistics; }
+
+ private:
+  uint64_t* get_words(int variable);
+  uint64_t get_word(int variable, std::size_t word) const;
+  void clear_slot(std::size_t slot);
+
+  std::size_t nr_words = 0;
+  std::size_t next_slot = 0;
+  // differences[v * nr_words + w]: bit i tells whether the copies of v differ in witness 64w+i.
+  std::vector<uint64_t> differences;
+  // Union of the differences of all always shared variables.
+  std::vector<uint64_t> always_shared_differences;
+  // The differing variables of each witness, to clear its slot when it is replaced.
+  std::vector<std::vector<int>> slot_variables;
+  Statistics statistics;
+};
+
+inline void WitnessPool::set_capacity(std::size_t capacity) {
+  nr_words = (capacity + 63) / 64;
+  next_slot = 0;
+  differences.clear();
+  always_shared_differences.assign(nr_words, 0);
+  slot_variables.assign(64 * nr_words, {});
+}
+
+inline void WitnessPool::clear() {
+  // Cheap when empty, as clauses are usually added in bulk.
+  if (!differences.empty()) {
+    set_capacity(64 * nr_words);
+  }
+}
+
+inline uint64_t* WitnessPool::get_words(int variable) {
+  auto end = (std::size_t(variable) + 1) * nr_words;
+  if (end > differences.size()) {
+    differences.resize(end, 0);
+  }
+  return differences.data() + std::size_t(variable) * nr_words;
+}
+
+inline uint64_t WitnessPool::get_word(int variable, std::size_t word) const {
+  auto index = std::size_t(variable) * nr_words + word;
+  return index < differences.size() ? differences[index] : 0;
+}
+
+inline void WitnessPool::clear_slot(std::size_t slot) {
+  auto word = slot / 64;
+  auto mask = ~(uint64_t(1) << (slot % 64));
+  for (auto v: slot_variables[slot]) {
+    get_words(v)[word] &= mask;
+  }
+  always_shared_differences[word] &= mask;
+  slot_variables[slot].clear();
+}
+
+inline void WitnessPool::add(std::span<const int> differing_variables, const std::vector<bool>& always_shared) {
+  if (!enabled()) {
+    return;
+  }
+  auto slot = next_slot;
+  next_slot = (next_slot + 1) % (64 * nr_words);
+  clear_slot(slot);
+  auto word = slot / 64;
+  auto bit = uint64_t(1) << (slot % 64);
+  for (auto v: differing_variables) {
+    get_words(v)[word] |= bit;
+    if (v < always_shared.size() && always_shared[v]) {
+      always_shared_differences[word] |= bit;
+    }
+  }
+  slot_variables[slot].assign(differing_variables.begin(), differing_variables.end());
+  statistics.added++;
+}
+
+inline void WitnessPool::add_always_shared(int variable) {
+  if (!enabled()) {
+    return;
+  }
+  for (std::size_t w = 0; w < nr_words; w++) {
+    always_shared_differences[w] |= get_word(variable, w);
+  }
+}
+
+inline bool WitnessPool::refutes(int variable, std::span<const int> shared_variables) {
+  if (!enabled()) {
+    return false;
+  }
+  statistics.screened++;
+  for (std::size_t w = 0; w < nr_words; w++) {
+    // Witnesses in which the copies of the variable differ but those of the shared variables agree.
+    auto candidates = get_word(variable, w) & ~always_shared_differences[w];
+    for (auto it = shared_variables.begin(); candidates && it != shared_variables.end(); ++it) {
+      candidates &= ~get_word(*it, w);
+    }
+    if (candidates) {
+      statistics.refuted++;
+      return true;
+    }
+  }
+  return false;
+}
+
+#endif // WITNESS_POOL_H_
@@ -0,0 +1,90 @@
+#ifndef ITP_WORK_QUEUE_H_
+#define ITP_WORK_QUEUE_H_
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+
+namespace cadical_itp {
+
+// Work-stealing queue over the task indices 0..nr_tasks-1.
+// Every worker starts with a contiguous block of tasks and takes them from the front, so
+// consecutive tasks tend to run on the same worker. A worker whose block is empty steals
+// the back half of the largest remaining block.
+class WorkStealingQueue {
+ public:
+  WorkStealingQueue(std::size_t nr_tasks, unsigned nr_workers);
+  // Hand out the next task of the worker. Returns false once all tasks have been handed out.
+  bool pop(unsigned worker, std::size_t& task);
+
+ private:
+  struct Block {
+    std::mutex mutex;
+    std::size_t begin;
+    std::size_t end;
+  };
+
+  bool steal(unsigned worker);
+
+  std::vector<std::unique_ptr<Block>> blocks;
+};
+
+inline WorkStealingQueue::WorkStealingQueue(std::size_t nr_tasks, unsigned nr_workers) {
+  for (unsigned worker = 0; worker < nr_workers; worker++) {
+    auto block = std::make_unique<Block>();
+    block->begin = nr_tasks * worker / nr_workers;
+    block->end = nr_tasks * (worker + 1) / nr_workers;
+    blocks.push_back(std::move(block));
+  }
+}
+
+inline bool WorkStealingQueue::pop(unsigned worker, std::size_t& task) {
+  auto& block = *blocks[worker];
+  do {
+    std::lock_guard<std::mutex> lock(block.mutex);
+    if (block.begin < block.end) {
+      task = block.begin++;
+      return true;
+    }
+  } while (steal(worker));
+  return false;
+}
+
+inline bool WorkStealingQueue::steal(unsigned worker) {
+  while (true) {
+    // Pick the largest block; it may shrink before we lock it again.
+    Block* victim = nullptr;
+    std::size_t victim_size = 0;
+    for (auto& block: blocks) {
+      std::lock_guard<std::mutex> lock(block->mutex);
+      if (block->end - block->begin > victim_size) {
+        victim = block.get();
+        victim_size = block->end - block->begin;
+      }
+    }
+    if (victim == nullptr) {
+      return false;
+    }
+    std::size_t begin, end;
+    {
+      std::lock_guard<std::mutex> lock(victim->mutex);
+      if (victim->begin == victim->end) {
+        continue;
+      }
+      begin = victim->begin + (victim->end - victim->begin) / 2;
+      end = victim->end;
+      victim->end = begin;
+    }
+    // Only the owner refills its block, so it is still empty.
+    auto& block = *blocks[worker];
+    std::lock_guard<std::mutex> lock(block.mutex);
+    block.begin = begin;
+    block.end = end;
+    return true;
+  }
+}
+
+}
+
+#endif // ITP_WORK_QUEUE_H_
@@ -0,0 +1,120 @@
+#ifndef ITP_TEST_CNF_CHECK_H_
+#define ITP_TEST_CNF_CHECK_H_
+
+#include <vector>
+#include <cstdlib>
+#include <cstdint>
+
+#include "aig/aig/aig.h"
+
+#include "cnf_encoder.hpp"
+
+namespace cadical_itp {
+
+using Clauses = std::vector<std::vector<int>>;
+
+// Small DPLL with unit propagation for the tiny formulas of the encoder tests. The assignment is
+// indexed by variables (1 true, -1 false, 0 open) and restored before returning.
+inline bool is_satisfiable(const Clauses& clauses, std::vector<int>& assignment) {
+  std::vector<int> trail;
+  auto undo = [&]() {
+    for (auto v: trail) {
+      assignment[v] = 0;
+    }
+  };
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (const auto& clause: clauses) {
+      int open = 0;
+      int unit = 0;
+      bool satisfied = false;
+      for (auto l: clause) {
+        auto value = assignment[abs(l)];
+        if (value == 0) {
+          open++;
+          unit = l;
+        } else if ((value > 0) == (l > 0)) {
+          satisfied = true;
+          break;
+        }
+      }
+      if (satisfied) {
+        continue;
+      } else if (open == 0) {
+        undo();
+        return false;
+      } else if (open == 1) {
+        assignment[abs(unit)] = unit > 0 ? 1 : -1;
+        trail.push_back(abs(unit));
+        changed = true;
+      }
+    }
+  }
+  int decision = 0;
+  for (const auto& clause: clauses) {
+    for (auto l: clause) {
+      if (assignment[abs(l)] == 0) {
+        decision = abs(l);
+        break;
+      }
+    }
+    if (decision != 0) {
+      break;
+    }
+  }
+  bool result = decision == 0;
+  for (int value: {1, -1}) {
+    if (result) {
+      break;
+    }
+    assignment[decision] = value;
+    result = is_satisfiable(clauses, assignment);
+    assignment[decision] = 0;
+  }
+  undo();
+  return result;
+}
+
+// Values of all objects of the AIG, indexed by object ids, with CI i set to bit i of inputs.
+inline std::vector<bool> simulate(abc::Aig_Man_t* man, uint64_t inputs) {
+  using namespace abc; // Needed for macro expansion.
+  std::vector<bool> values(Aig_ManObjNumMax(man), false);
+  values[Aig_ObjId(Aig_ManConst1(man))] = true;
+  Aig_Obj_t* node;
+  int i;
+  Aig_ManForEachCi(man, node, i) {
+    values[Aig_ObjId(node)] = (inputs >> i) & 1;
+  }
+  // Nodes are created after their fanins, so object ids are a topological order.
+  Aig_ManForEachNode(man, node, i) {
+    values[Aig_ObjId(node)] = (values[Aig_ObjId(Aig_ObjFanin0(node))] != static_cast<bool>(Aig_ObjFaninC0(node)))
+                              && (values[Aig_ObjId(Aig_ObjFanin1(node))] != static_cast<bool>(Aig_ObjFaninC1(node)));
+  }
+  return values;
+}
+
+inline bool evaluate(const std::vector<bool>& values, abc::Aig_Obj_t* literal) {
+  return values[abc::Aig_ObjId(abc::Aig_Regular(literal))] != static_cast<bool>(abc::Aig_IsComplement(literal));
+}
+
+// Whether an encoding used in the given polarities can set the output variable to output when the AIG
+// evaluates to value: the positive literal implies the AIG, the negative one is implied by it.
+inline bool is_consistent(OutputPolarity polarity, bool output, bool value) {
+  switch (polarity) {
+    case OutputPolarity::POSITIVE:
+      return !output || value;
+    case OutputPolarity::NEGATIVE:
+      return output || !value;
+    default:
+      return output == value;
+  }
+}
+
+// Polarities an encoding guarantees, as Tseitin always encodes both implications.
+inline OutputPolarity get_guaranteed_polarity(const CnfEncodingConfig& config) {
+  return config.encoding == CnfEncoding::TSEITIN ? OutputPolarity::BOTH : config.polarity;
+}
+
+}
+
+#endif // ITP_TEST_CNF_CHECK_H_
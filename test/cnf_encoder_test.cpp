@@ -0,0 +1,102 @@
+// Compares the polarity-aware and LUT encodings with the Tseitin encoding on random AIGs: for every input
+// assignment and output value, each encoding must be satisfiable exactly when the output is consistent
+// with the AIG in the polarities it encodes.
+
+#include <random>
+#include <algorithm>
+#include <string>
+#include <iostream>
+
+#include "cnf_check.hpp"
+
+using namespace abc; // Needed for macro expansion.
+using namespace cadical_itp;
+
+namespace {
+
+constexpr int ITERATIONS = 300;
+constexpr int MAX_INPUTS = 6;
+constexpr int MAX_NODES = 30;
+constexpr int AUXILIARY_VARIABLE_START = MAX_INPUTS + 1;
+
+std::string to_string(const CnfEncodingConfig& config) {
+  static const char* encodings[] = {"tseitin", "plaisted-greenbaum", "lut"};
+  static const char* polarities[] = {"positive", "negative", "both"};
+  auto name = std::string(encodings[static_cast<int>(config.encoding)]) + "/" + polarities[static_cast<int>(config.polarity)];
+  if (config.encoding == CnfEncoding::LUT) {
+    name += "/" + std::to_string(config.lut_size);
+  }
+  return name;
+}
+
+std::vector<CnfEncodingConfig> get_configs() {
+  std::vector<CnfEncodingConfig> configs;
+  for (auto polarity: {OutputPolarity::BOTH, OutputPolarity::POSITIVE, OutputPolarity::NEGATIVE}) {
+    configs.push_back(CnfEncodingConfig{CnfEncoding::TSEITIN, polarity});
+    configs.push_back(CnfEncodingConfig{CnfEncoding::PLAISTED_GREENBAUM, polarity});
+    for (unsigned lut_size: {2u, 3u, 4u, 6u}) {
+      configs.push_back(CnfEncodingConfig{CnfEncoding::LUT, polarity, lut_size});
+    }
+  }
+  return configs;
+}
+
+}
+
+int main() {
+  std::mt19937 rng(7);
+  auto configs = get_configs();
+  std::vector<uint64_t> literals(configs.size(), 0);
+  int failures = 0;
+  for (int iteration = 0; iteration < ITERATIONS; iteration++) {
+    int nr_inputs = 2 + rng() % (MAX_INPUTS - 1);
+    auto man = Aig_ManStart(0);
+    std::vector<Aig_Obj_t*> nodes;
+    std::vector<int> input_variables;
+    for (int i = 0; i < nr_inputs; i++) {
+      nodes.push_back(Aig_ObjCreateCi(man));
+      input_variables.push_back(i + 1);
+    }
+    int nr_nodes = 1 + rng() % MAX_NODES;
+    for (int i = 0; i < nr_nodes; i++) {
+      auto left = Aig_NotCond(nodes[rng() % nodes.size()], rng() % 2);
+      auto right = Aig_NotCond(nodes[rng() % nodes.size()], rng() % 2);
+      nodes.push_back(Aig_And(man, left, right));
+    }
+    auto output = Aig_NotCond(rng() % 10 == 0 ? Aig_ManConst1(man) : nodes.back(), rng() % 2);
+    Aig_ObjCreateCo(man, output);
+
+    for (std::size_t c = 0; c < configs.size(); c++) {
+      CnfEncodingStatistics statistics;
+      auto clauses = encode_aig(man, input_variables, AUXILIARY_VARIABLE_START, configs[c], statistics);
+      literals[c] += statistics.literals;
+      int max_variable = AUXILIARY_VARIABLE_START;
+      for (const auto& clause: clauses) {
+        for (auto l: clause) {
+          max_variable = std::max(max_variable, abs(l));
+        }
+      }
+      auto polarity = get_guaranteed_polarity(configs[c]);
+      for (uint64_t inputs = 0; inputs < (1u << nr_inputs); inputs++) {
+        auto value = evaluate(simulate(man, inputs), output);
+        for (bool output_value: {false, true}) {
+          std::vector<int> assignment(max_variable + 1, 0);
+          for (int i = 0; i < nr_inputs; i++) {
+            assignment[input_variables[i]] = (inputs >> i) & 1 ? 1 : -1;
+          }
+          assignment[AUXILIARY_VARIABLE_START] = output_value ? 1 : -1;
+          if (is_satisfiable(clauses, assignment) != is_consistent(polarity, output_value, value)) {
+            std::cerr << "Mismatch for " << to_string(configs[c]) << " in iteration " << iteration << " with inputs " << inputs
+                      << " and output " << output_value << std::endl;
+            failures++;
+          }
+        }
+      }
+    }
+    Aig_ManStop(man);
+  }
+  for (std::size_t c = 0; c < configs.size(); c++) {
+    std::cout << to_string(configs[c]) << ": " << literals[c] << " literals" << std::endl;
+  }
+  return failures == 0 ? 0 : 1;
+}